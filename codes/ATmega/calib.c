@@ -0,0 +1,225 @@
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+#include <avr/eeprom.h>
+#include <util/delay.h>
+#include <stdlib.h>
+#include "calib.h"
+#include "imu.h"
+
+#define CALIB_MAGIC         0xC6    // 0xC5 records stored gravity as x/y offsets
+#define CALIB_MULT_MIN      8       // 2x noise
+#define CALIB_MULT_MAX      64      // 16x noise
+#define CALIB_MULT_STEP     2
+
+typedef struct {
+    uint8_t magic;
+    calib_t cal;
+    uint8_t checksum;
+} calib_record_t;
+
+static calib_record_t EEMEM calib_ee[CALIB_SLOTS];
+
+static calib_record_t *calib_slot(const imu_t *imu)
+{
+    return &calib_ee[imu->addr == IMU_ADDR_HIGH ? 0 : 1];
+}
+
+static uint8_t calib_checksum(const calib_t *cal)
+{
+    const uint8_t *p = (const uint8_t *)cal;
+    uint8_t sum = CALIB_MAGIC;
+
+    for (uint8_t i = 0; i < sizeof(*cal); i++)
+        sum = (uint8_t)((sum << 1) | (sum >> 7)) ^ p[i];
+
+    return sum;
+}
+
+int calib_load(calib_t *cal, const imu_t *imu)
+{
+    calib_record_t rec;
+
+    eeprom_read_block(&rec, calib_slot(imu), sizeof(rec));
+
+    if (rec.magic != CALIB_MAGIC || rec.checksum != calib_checksum(&rec.cal))
+        return -1;
+    if (rec.cal.sensitivity < CALIB_MULT_MIN || rec.cal.sensitivity > CALIB_MULT_MAX)
+        return -1;
+
+    *cal = rec.cal;
+    return 0;
+}
+
+void calib_save(const calib_t *cal, const imu_t *imu)
+{
+    calib_record_t rec;
+
+    rec.magic = CALIB_MAGIC;
+    rec.cal = *cal;
+    rec.checksum = calib_checksum(cal);
+
+    eeprom_update_block(&rec, calib_slot(imu), sizeof(rec));
+}
+
+/* Integer square root, bit by bit; only runs while calibrating */
+static uint16_t isqrt32(uint32_t v)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+
+    while (bit > v)
+        bit >>= 2;
+
+    while (bit)
+    {
+        if (v >= root + bit)
+        {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint16_t)root;
+}
+
+int calib_run(calib_t *cal, const imu_t *imu, int16_t rest[3], int16_t noise[3])
+{
+    int16_t first[3];
+    int32_t sum[3] = {0, 0, 0};
+    int32_t dev[3] = {0, 0, 0};
+    uint8_t buf[6];
+    int32_t minor_sq = 0, g_sq;
+    int16_t expected;
+    uint8_t axis;
+    uint8_t dominant = 0;
+
+    /* mean per axis, relative to the first sample to keep the sums small */
+    for (uint8_t n = 0; n < CALIB_SAMPLES; n++)
+    {
+        if (imu_read_acc_bytes(imu, buf) < 0)
+            return -1;
+
+        for (axis = 0; axis < 3; axis++)
+        {
+            int16_t v = (int16_t)((buf[2 * axis + 1] << 8) | buf[2 * axis]);
+            if (n == 0)
+                first[axis] = v;
+            sum[axis] += v - first[axis];
+        }
+        _delay_ms(10);
+    }
+
+    for (axis = 0; axis < 3; axis++)
+        rest[axis] = (int16_t)(first[axis] + sum[axis] / CALIB_SAMPLES);
+
+    /* second pass for the mean absolute deviation around the rest level */
+    for (uint8_t n = 0; n < CALIB_SAMPLES; n++)
+    {
+        if (imu_read_acc_bytes(imu, buf) < 0)
+            return -1;
+
+        for (axis = 0; axis < 3; axis++)
+        {
+            int16_t v = (int16_t)((buf[2 * axis + 1] << 8) | buf[2 * axis]);
+            dev[axis] += labs((int32_t)v - rest[axis]);
+        }
+        _delay_ms(10);
+    }
+
+    for (axis = 0; axis < 3; axis++)
+    {
+        noise[axis] = (int16_t)(dev[axis] / CALIB_SAMPLES);
+        if (abs(rest[axis]) > abs(rest[dominant]))
+            dominant = axis;
+    }
+
+    /*
+     * One pose cannot tell a tilted sensor from offsets on the other axes,
+     * so those are taken as zero and gravity.c deals with the tilt. Only the
+     * dominant axis gets an offset: whatever makes the rest vector 1 g long.
+     */
+    for (axis = 0; axis < 3; axis++)
+    {
+        if (axis != dominant)
+            minor_sq += (int32_t)rest[axis] * rest[axis];
+        cal->zero_offset[axis] = 0;
+    }
+
+    g_sq = (int32_t)IMU_ACC_LSB_PER_G * IMU_ACC_LSB_PER_G;
+    expected = (int16_t)isqrt32(minor_sq < g_sq ? (uint32_t)(g_sq - minor_sq) : 0);
+    if (rest[dominant] < 0)
+        expected = -expected;
+
+    cal->zero_offset[dominant] = rest[dominant] - expected;
+    rest[dominant] = expected;
+
+    return 0;
+}
+
+int calib_boot(calib_t *cal, const imu_t *imu, uint8_t default_sensitivity,
+               int16_t rest[3], int16_t noise[3])
+{
+    uint8_t buf[6];
+
+    if (calib_load(cal, imu) == 0)
+    {
+        if (imu_read_acc_bytes(imu, buf) < 0)
+            return -1;
+
+        for (uint8_t axis = 0; axis < 3; axis++)
+        {
+            int16_t v = (int16_t)((buf[2 * axis + 1] << 8) | buf[2 * axis]);
+            rest[axis] = v - cal->zero_offset[axis];
+            noise[axis] = 0;
+        }
+        return 0;
+    }
+
+    cal->sensitivity = default_sensitivity;
+    if (calib_run(cal, imu, rest, noise) < 0)
+        return -1;
+
+    calib_save(cal, imu);
+    return 1;
+}
+
+calib_result_t calib_command(calib_t *cal, const imu_t *imu, int cmd,
+                             int16_t rest[3], int16_t noise[3])
+{
+    calib_result_t result;
+
+    switch (cmd)
+    {
+        case CALIB_CMD_RUN:
+            if (calib_run(cal, imu, rest, noise) < 0)
+                return CALIB_UNCHANGED;
+            result = CALIB_RECALIBRATED;
+            break;
+
+        case CALIB_CMD_MORE:
+            if (cal->sensitivity <= CALIB_MULT_MIN)
+                return CALIB_UNCHANGED;
+            cal->sensitivity -= CALIB_MULT_STEP;
+            result = CALIB_SENSITIVITY;
+            break;
+
+        case CALIB_CMD_LESS:
+            if (cal->sensitivity >= CALIB_MULT_MAX)
+                return CALIB_UNCHANGED;
+            cal->sensitivity += CALIB_MULT_STEP;
+            result = CALIB_SENSITIVITY;
+            break;
+
+        default:
+            return CALIB_UNCHANGED;
+    }
+
+    calib_save(cal, imu);
+    return result;
+}
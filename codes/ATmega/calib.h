@@ -0,0 +1,63 @@
+#ifndef CALIB_H
+#define CALIB_H
+
+#include <stdint.h>
+#include "imu.h"
+
+/*
+ * Per-sensor calibration kept in EEPROM: zero-g offsets for each axis and
+ * the detector sensitivity (trigger level in quarters of the measured noise).
+ * Each IMU address has its own record; IMU_ADDR_HIGH keeps the slot that
+ * single-sensor nodes have always used.
+ */
+
+#define CALIB_SAMPLES       64      // samples averaged while the node is at rest
+#define CALIB_SLOTS         2       // one per LSM6 address
+
+/* Single-character commands accepted over the UART link */
+#define CALIB_CMD_RUN       'C'     // re-run calibration and store it
+#define CALIB_CMD_MORE      '+'     // lower the trigger multiple (more sensitive)
+#define CALIB_CMD_LESS      '-'     // raise the trigger multiple (less sensitive)
+
+typedef struct {
+    int16_t zero_offset[3];         // raw counts removed from x, y, z
+    uint8_t sensitivity;            // detector noise_mult
+} calib_t;
+
+typedef enum {
+    CALIB_UNCHANGED = 0,
+    CALIB_SENSITIVITY,              // only calib_t.sensitivity changed
+    CALIB_RECALIBRATED              // offsets re-measured, rest/noise filled in
+} calib_result_t;
+
+/* Returns 0 if a valid calibration was read from EEPROM, -1 otherwise */
+int calib_load(calib_t *cal, const imu_t *imu);
+
+void calib_save(const calib_t *cal, const imu_t *imu);
+
+/*
+ * Sample the IMU at rest. Fills the zero-g offset of the dominant axis,
+ * the one that scales the rest vector to 1 g (the others are left at 0,
+ * gravity on them is tilt), and reports the resting level and mean
+ * absolute noise of each axis so a detector can be seeded. Returns -1 on
+ * I2C failure.
+ */
+int calib_run(calib_t *cal, const imu_t *imu, int16_t rest[3], int16_t noise[3]);
+
+/*
+ * Boot-time entry point: load the stored calibration, or measure and store a
+ * new one with the given default sensitivity. rest/noise are always filled in
+ * (noise is 0 when loaded from EEPROM). Returns 1 if a calibration was run,
+ * 0 if loaded, -1 on I2C failure.
+ */
+int calib_boot(calib_t *cal, const imu_t *imu, uint8_t default_sensitivity,
+               int16_t rest[3], int16_t noise[3]);
+
+/*
+ * Handle one received command byte; any change is saved before returning.
+ * A node with two sensors passes every command to both.
+ */
+calib_result_t calib_command(calib_t *cal, const imu_t *imu, int cmd,
+                             int16_t rest[3], int16_t noise[3]);
+
+#endif /* CALIB_H */
@@ -0,0 +1,131 @@
+#include "detector.h"
+
+static void update_trigger(detector_t *det)
+{
+    int32_t trig = ((int32_t)detector_noise(det) * det->noise_mult) >> 2;
+
+    if (trig < det->cfg->trigger_floor)
+        trig = det->cfg->trigger_floor;
+    if (trig > INT16_MAX)
+        trig = INT16_MAX;
+
+    det->trigger = (int16_t)trig;
+}
+
+void detector_init(detector_t *det, const detector_config_t *cfg,
+                   int16_t baseline, int16_t noise)
+{
+    det->cfg = cfg;
+    det->base_acc = (int32_t)baseline << DET_BASE_SHIFT;
+    det->noise_acc = (int32_t)noise << DET_NOISE_SHIFT;
+    det->noise_mult = cfg->noise_mult;
+    det->peak = 0;
+    det->prev_dev = 0;
+    det->onset_sent = 0;
+    det->state = DET_ARMED;
+    det->since_strike = cfg->holdoff;
+    update_trigger(det);
+}
+
+void detector_set_sensitivity(detector_t *det, uint8_t noise_mult)
+{
+    det->noise_mult = noise_mult;
+    update_trigger(det);
+}
+
+int16_t detector_baseline(const detector_t *det)
+{
+    return (int16_t)(det->base_acc >> DET_BASE_SHIFT);
+}
+
+int16_t detector_noise(const detector_t *det)
+{
+    return (int16_t)(det->noise_acc >> DET_NOISE_SHIFT);
+}
+
+uint8_t detector_velocity(int16_t amplitude)
+{
+    uint8_t v = (uint8_t)((amplitude < 0 ? 0 : amplitude) >> 8);
+    return v ? v : 1;
+}
+
+static uint8_t is_onset(const detector_t *det, int32_t dev)
+{
+    int16_t half = det->trigger >> 1;
+    int16_t slope = det->cfg->onset_slope;
+
+    if (slope == 0 || dev <= half)
+        return 0;
+    if (slope < half)
+        slope = half;
+
+    return (dev - det->prev_dev) > slope;
+}
+
+uint8_t detector_update(detector_t *det, int16_t sample, int16_t *amplitude)
+{
+    int32_t dev = (int32_t)sample - detector_baseline(det);
+    uint8_t events = 0;
+
+    if (det->cfg->polarity < 0)
+        dev = -dev;
+    if (dev > INT16_MAX)
+        dev = INT16_MAX;
+    if (dev < INT16_MIN)
+        dev = INT16_MIN;
+
+    if (det->since_strike < 255)
+        det->since_strike++;
+
+    switch (det->state)
+    {
+        case DET_ARMED:
+            if (det->since_strike >= det->cfg->holdoff)
+            {
+                det->onset_sent = is_onset(det, dev);
+                if (det->onset_sent || dev > det->trigger)
+                {
+                    det->peak = (int16_t)dev;
+                    det->state = DET_IN_STRIKE;
+                    events = det->onset_sent ? DET_EVENT_ONSET : 0;
+                    break;
+                }
+            }
+
+            /* only learn the resting signal while no strike is in progress */
+            det->base_acc += sample - detector_baseline(det);
+            det->noise_acc += (dev < 0 ? -dev : dev) - detector_noise(det);
+            update_trigger(det);
+            break;
+
+        case DET_IN_STRIKE:
+            if (dev > det->peak)
+            {
+                det->peak = (int16_t)dev;
+                break;
+            }
+
+            if (amplitude)
+                *amplitude = det->peak;
+            events = DET_EVENT_PEAK | (det->onset_sent ? 0 : DET_EVENT_ONSET);
+            det->state = DET_HOLDOFF;
+            det->since_strike = 0;
+            break;
+
+        case DET_HOLDOFF:
+            if (dev < (det->trigger >> 1))
+            {
+                det->state = DET_ARMED;
+            }
+            else if (det->since_strike >= DET_STUCK_SAMPLES)
+            {
+                /* the resting level moved (e.g. new grip), start over from here */
+                det->base_acc = (int32_t)sample << DET_BASE_SHIFT;
+                det->state = DET_ARMED;
+            }
+            break;
+    }
+
+    det->prev_dev = (int16_t)dev;
+    return events;
+}
@@ -0,0 +1,85 @@
+#ifndef DETECTOR_H
+#define DETECTOR_H
+
+#include <stdint.h>
+
+/*
+ * Adaptive single-axis strike detector.
+ *
+ * Tracks the resting signal (baseline) and its mean absolute deviation
+ * (noise) with integer EWMAs. A strike starts when the deviation from the
+ * baseline exceeds noise_mult/4 times the noise (never less than
+ * trigger_floor), its peak is reported one sample after it happens, and the
+ * detector re-arms once the deviation has fallen below half the trigger level.
+ *
+ * With onset_slope set, a strike is also reported at its onset: as soon as
+ * the deviation is past half the trigger level and still climbing by more
+ * than max(onset_slope, trigger/2) per sample. That is usually the first
+ * sample of the spike, one or more samples before the peak event that then
+ * follows with the strike amplitude.
+ *
+ * An onset is a commitment: the hit has gone out before the peak is known,
+ * so a fast rise that tops out under the trigger level still plays, with
+ * the low velocity of its peak. That is the price of not waiting for the
+ * peak; onset_slope = 0 only reports strikes that reach the trigger.
+ * codes/Host/onset_latency counts how often it happens on a trace.
+ *
+ * Plain C, no AVR headers, so it can be built and replayed on a host.
+ */
+
+#define DET_BASE_SHIFT      5       // baseline EWMA, alpha = 1/32
+#define DET_NOISE_SHIFT     6       // noise EWMA, alpha = 1/64
+#define DET_STUCK_SAMPLES   250     // force a re-arm after this many samples
+
+/* detector_update() event bits */
+#define DET_EVENT_ONSET     0x01    // strike started, send the trigger now
+#define DET_EVENT_PEAK      0x02    // strike peaked, amplitude is valid
+
+typedef struct {
+    int8_t   polarity;          // +1: strikes push the axis up, -1: down
+    uint8_t  noise_mult;        // default trigger level, in quarters of the noise
+    int16_t  trigger_floor;     // minimum trigger level, raw counts
+    uint8_t  holdoff;           // minimum samples between strikes
+    int16_t  onset_slope;       // minimum rise per sample for an onset, 0: peak only
+} detector_config_t;
+
+typedef enum {
+    DET_ARMED = 0,
+    DET_IN_STRIKE,
+    DET_HOLDOFF
+} detector_state_t;
+
+typedef struct {
+    const detector_config_t *cfg;
+    int32_t  base_acc;          // baseline << DET_BASE_SHIFT
+    int32_t  noise_acc;         // noise << DET_NOISE_SHIFT
+    int16_t  trigger;           // current trigger level, raw counts
+    int16_t  peak;
+    int16_t  prev_dev;
+    uint8_t  noise_mult;
+    uint8_t  state;
+    uint8_t  since_strike;
+    uint8_t  onset_sent;
+} detector_t;
+
+void detector_init(detector_t *det, const detector_config_t *cfg,
+                   int16_t baseline, int16_t noise);
+
+/* Override the trigger multiple (quarters of the noise), e.g. from calibration */
+void detector_set_sensitivity(detector_t *det, uint8_t noise_mult);
+
+/*
+ * Feed one sample. Returns a mask of DET_EVENT_* bits. Every strike produces
+ * exactly one ONSET and one PEAK event, together when onset detection is off
+ * or did not catch the strike. On PEAK the peak deviation from the baseline
+ * (always positive) is written to amplitude.
+ */
+uint8_t detector_update(detector_t *det, int16_t sample, int16_t *amplitude);
+
+/* Map a peak amplitude to a 1..127 hit velocity */
+uint8_t detector_velocity(int16_t amplitude);
+
+int16_t detector_baseline(const detector_t *det);
+int16_t detector_noise(const detector_t *det);
+
+#endif /* DETECTOR_H */
@@ -0,0 +1,260 @@
+#include <stdint.h>
+#include "display.h"
+#include "ST7735.h"
+#include "LCD_GFX.h"
+#include "ASCII_LUT.h"
+
+typedef struct {
+    uint8_t  x, y, width;
+    uint16_t fg, bg;
+    uint32_t dirty;                     // one bit per character cell
+    char     text[DISPLAY_FIELD_CHARS];
+} display_field_t;
+
+typedef struct {
+    uint8_t  x0, y0, x1, y1;
+    uint16_t color;
+} display_rect_t;
+
+typedef struct {
+    char    c;
+    uint8_t rows[DISPLAY_CHAR_H];       // bit n = pixel column n
+} glyph_t;
+
+static display_field_t fields[DISPLAY_MAX_FIELDS];
+static uint8_t field_count = 0;
+static uint8_t next_field = 0;          // round-robin start for fairness
+
+static display_rect_t fills[DISPLAY_MAX_FILLS];
+static uint8_t fill_head = 0, fill_count = 0;
+
+static glyph_t glyph_cache[DISPLAY_GLYPH_CACHE];
+static uint8_t glyph_next = 0;
+
+void display_init(void)
+{
+    field_count = 0;
+    next_field = 0;
+    fill_head = fill_count = 0;
+
+    for (uint8_t i = 0; i < DISPLAY_GLYPH_CACHE; i++)
+        glyph_cache[i].c = 0;
+    glyph_next = 0;
+}
+
+uint8_t display_add_field(uint8_t x, uint8_t y, uint8_t width, uint16_t fg, uint16_t bg)
+{
+    display_field_t *f;
+
+    if (field_count >= DISPLAY_MAX_FIELDS)
+        return 0xFF;
+    if (width > DISPLAY_FIELD_CHARS)
+        width = DISPLAY_FIELD_CHARS;
+
+    f = &fields[field_count];
+    f->x = x;
+    f->y = y;
+    f->width = width;
+    f->fg = fg;
+    f->bg = bg;
+    for (uint8_t i = 0; i < width; i++)
+        f->text[i] = ' ';
+    f->dirty = 0;
+
+    return field_count++;
+}
+
+void display_set_text(uint8_t field, const char *text)
+{
+    display_field_t *f;
+
+    if (field >= field_count)
+        return;
+
+    f = &fields[field];
+    for (uint8_t i = 0; i < f->width; i++)
+    {
+        char c = (text && *text) ? *text++ : ' ';
+
+        if (c < 0x20 || c > 0x7E)
+            c = '?';
+        if (f->text[i] != c)
+        {
+            f->text[i] = c;
+            f->dirty |= (uint32_t)1 << i;
+        }
+    }
+}
+
+void display_set_colors(uint8_t field, uint16_t fg, uint16_t bg)
+{
+    if (field >= field_count)
+        return;
+    if (fields[field].fg == fg && fields[field].bg == bg)
+        return;
+
+    fields[field].fg = fg;
+    fields[field].bg = bg;
+    display_invalidate(field);
+}
+
+void display_invalidate(uint8_t field)
+{
+    if (field < field_count)
+        fields[field].dirty = ((uint32_t)1 << fields[field].width) - 1;
+}
+
+int display_fill(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint16_t color)
+{
+    display_rect_t *r;
+
+    if (fill_count >= DISPLAY_MAX_FILLS)
+        return -1;
+
+    r = &fills[(fill_head + fill_count) % DISPLAY_MAX_FILLS];
+    r->x0 = x0;
+    r->y0 = y0;
+    r->x1 = x1;
+    r->y1 = y1;
+    r->color = color;
+    fill_count++;
+
+    return 0;
+}
+
+/* Row-major bitmap of a character, transposed from the column-major font */
+static const uint8_t *glyph_rows(char c)
+{
+    glyph_t *g;
+
+    for (uint8_t i = 0; i < DISPLAY_GLYPH_CACHE; i++)
+    {
+        if (glyph_cache[i].c == c)
+            return glyph_cache[i].rows;
+    }
+
+    g = &glyph_cache[glyph_next];
+    if (++glyph_next == DISPLAY_GLYPH_CACHE)
+        glyph_next = 0;
+
+    g->c = c;
+    for (uint8_t r = 0; r < DISPLAY_CHAR_H; r++)
+        g->rows[r] = 0;
+
+    for (uint8_t col = 0; col < 5; col++)
+    {
+        uint8_t bits = (uint8_t)ASCII[c - 0x20][col];
+        for (uint8_t r = 0; r < DISPLAY_CHAR_H; r++)
+        {
+            if (bits & (1 << r))
+                g->rows[r] |= (uint8_t)(1 << col);
+        }
+    }
+
+    return g->rows;
+}
+
+/* One address window per glyph, pixels streamed in window order */
+static void draw_cell(uint8_t x, uint8_t y, char c, uint16_t fg, uint16_t bg)
+{
+    const uint8_t *rows = glyph_rows(c);
+
+    LCD_setAddr(x, y, x + DISPLAY_CHAR_W - 1, y + DISPLAY_CHAR_H - 1);
+    for (uint8_t r = 0; r < DISPLAY_CHAR_H; r++)
+    {
+        uint8_t bits = rows[r];
+        for (uint8_t col = 0; col < DISPLAY_CHAR_W; col++)
+        {
+            SPI_ControllerTx_16bit((bits & 1) ? fg : bg);
+            bits >>= 1;
+        }
+    }
+}
+
+/* Fill as many whole rows of the oldest queued rectangle as the budget allows */
+static uint16_t fill_slice(uint16_t budget)
+{
+    display_rect_t *r = &fills[fill_head];
+    uint16_t w = (uint16_t)(r->x1 - r->x0) + 1;
+    uint16_t rows = budget / w;
+    uint16_t remaining = (uint16_t)(r->y1 - r->y0) + 1;
+    uint16_t n;
+
+    if (rows == 0)
+        rows = 1;
+    if (rows > remaining)
+        rows = remaining;
+
+    LCD_setAddr(r->x0, r->y0, r->x1, (uint8_t)(r->y0 + rows - 1));
+    for (n = rows * w; n > 0; n--)
+        SPI_ControllerTx_16bit(r->color);
+
+    if (rows == remaining)
+    {
+        fill_head = (fill_head + 1) % DISPLAY_MAX_FILLS;
+        fill_count--;
+    }
+    else
+    {
+        r->y0 += (uint8_t)rows;
+    }
+
+    return (uint16_t)(rows * w);
+}
+
+/* Draw the next dirty cell, scanning fields round-robin. Returns 0 if none. */
+static uint8_t cell_slice(void)
+{
+    for (uint8_t n = 0; n < field_count; n++)
+    {
+        display_field_t *f = &fields[next_field];
+
+        if (f->dirty)
+        {
+            for (uint8_t i = 0; i < f->width; i++)
+            {
+                uint32_t bit = (uint32_t)1 << i;
+                if (f->dirty & bit)
+                {
+                    f->dirty &= ~bit;
+                    draw_cell(f->x + i * DISPLAY_CHAR_W, f->y, f->text[i], f->fg, f->bg);
+                    return 1;
+                }
+            }
+        }
+
+        if (++next_field >= field_count)
+            next_field = 0;
+    }
+
+    return 0;
+}
+
+uint8_t display_service(void)
+{
+    int16_t budget = DISPLAY_SLICE_PIXELS;
+
+    while (budget > 0)
+    {
+        if (fill_count)
+        {
+            budget -= (int16_t)fill_slice((uint16_t)budget);
+        }
+        else if (cell_slice())
+        {
+            budget -= DISPLAY_CHAR_W * DISPLAY_CHAR_H;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+void display_flush(void)
+{
+    while (display_service())
+        ;
+}
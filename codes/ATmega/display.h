@@ -0,0 +1,49 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdint.h>
+
+/*
+ * Incremental text display on top of the ST7735 driver.
+ *
+ * The screen is described as a few fixed text fields. Setting a field only
+ * marks the character cells that actually changed; display_service() then
+ * redraws dirty cells one glyph per address window, and works through
+ * queued rectangle fills a few rows at a time, stopping once it has pushed
+ * DISPLAY_SLICE_PIXELS pixels. Call it from a low priority task so no
+ * single call holds the CPU for more than about a millisecond.
+ */
+
+#define DISPLAY_MAX_FIELDS      6
+#define DISPLAY_FIELD_CHARS     20
+#define DISPLAY_MAX_FILLS       4
+#define DISPLAY_SLICE_PIXELS    256     // ~1 ms of SPI traffic per call
+#define DISPLAY_GLYPH_CACHE     12
+
+#define DISPLAY_CHAR_W          6       // 5 pixel glyph + 1 column spacing
+#define DISPLAY_CHAR_H          8
+
+void display_init(void);
+
+/* Register a text field of width characters at (x, y). Returns its id. */
+uint8_t display_add_field(uint8_t x, uint8_t y, uint8_t width, uint16_t fg, uint16_t bg);
+
+/* Set the field text; anything past the end of text is shown as spaces */
+void display_set_text(uint8_t field, const char *text);
+
+/* Change colours; the whole field is redrawn if they differ */
+void display_set_colors(uint8_t field, uint16_t fg, uint16_t bg);
+
+/* Force a full redraw of a field, e.g. after a fill was drawn over it */
+void display_invalidate(uint8_t field);
+
+/* Queue a solid rectangle (inclusive corners). Returns -1 if the queue is full. */
+int display_fill(uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, uint16_t color);
+
+/* Do one bounded slice of pending drawing. Returns 1 while work remains. */
+uint8_t display_service(void);
+
+/* Draw everything that is pending, for use before the scheduler runs */
+void display_flush(void);
+
+#endif /* DISPLAY_H */
@@ -0,0 +1,178 @@
+#define F_CPU 16000000UL
+#include <avr/io.h>
+#include <util/delay.h>
+#include <stdio.h>
+#include "uart.h"
+#include "i2c.h"
+#include "imu.h"
+#include "strike.h"
+#include "calib.h"
+#include "roles.h"
+#include "hc05.h"
+#include "trace.h"
+#include "prof.h"
+#include "power.h"
+#include "sched.h"
+
+/*
+ * Both feet on one node: the kick pedal LSM6 at IMU_ADDR_HIGH and the hi-hat
+ * foot at IMU_ADDR_LOW, on the same TWI bus. One task reads the two sensors
+ * back to back every sample period and runs a detector for each, so both
+ * stay at the full rate and one HC-05 carries both pads.
+ */
+
+#define LED_PULSE_MS        50
+#define COMMAND_PERIOD_MS   50
+#define SAMPLE_PERIOD_MS    KICK_PEDAL_SAMPLE_PERIOD_MS
+
+#define LED_PORT   PORTB
+#define LED_DDR    DDRB
+#define LED_PIN    PB5
+
+#define FOOT_KICK   0
+#define FOOT_HIHAT  1
+#define FEET        2
+
+typedef struct {
+    const strike_role_t *role;
+    uint8_t addr;
+    imu_t imu;
+    calib_t cal;
+    int16_t rest[3], noise[3];
+    strike_t strike;
+} foot_t;
+
+static const strike_role_t kick_role = ROLE_KICK_PEDAL;
+static const strike_role_t hihat_role = ROLE_HIHAT_FOOT;
+
+static foot_t feet[FEET] = {
+    [FOOT_KICK]  = { .role = &kick_role,  .addr = IMU_ADDR_HIGH },
+    [FOOT_HIHAT] = { .role = &hihat_role, .addr = IMU_ADDR_LOW },
+};
+static hc05_test_t link;         // boot self-test result
+
+static uint8_t detect_id;
+static uint8_t led_off_task;
+
+static void led_off(void)
+{
+    LED_PORT &= ~(1 << LED_PIN);
+}
+
+static void detect_task(void)
+{
+    int16_t acc[FEET][3];
+    uint8_t events = 0;
+    uint8_t kick_new = 1;
+    int err;
+    prof_t t;
+
+    t = PROF_BEGIN();
+    /* while tracing, the kick sensor's samples come from the trace */
+    if (trace_active())
+    {
+        kick_new = trace_take(acc[FOOT_KICK], NULL);
+        err = imu_read_acc(&feet[FOOT_HIHAT].imu, acc[FOOT_HIHAT]);
+    }
+    else
+    {
+        err = imu_read_acc_pair(&feet[FOOT_KICK].imu, &feet[FOOT_HIHAT].imu,
+                                acc[FOOT_KICK], acc[FOOT_HIHAT]);
+    }
+    if (err != 0)
+    {
+        PROF_COUNT(PROF_CNT_I2C_ERROR);
+        return;
+    }
+    PROF_END(PROF_I2C, t);
+
+    for (uint8_t i = 0; i < FEET; i++)
+    {
+        if (i == FOOT_KICK && !kick_new)
+            continue;
+        events |= strike_update(&feet[i].strike, acc[i], NULL);
+    }
+
+    if (events & DET_EVENT_ONSET)
+    {
+        power_hit();
+        LED_PORT |= (1 << LED_PIN);
+        sched_start(led_off_task, LED_PULSE_MS);
+    }
+}
+
+static void command_task(void)
+{
+    int cmd = uart_try_receive();
+
+    if (trace_command(cmd) || prof_command(cmd))
+    {
+        return;
+    }
+
+    /* calibration commands apply to both sensors */
+    for (uint8_t i = 0; i < FEET; i++)
+    {
+        foot_t *f = &feet[i];
+
+        switch (calib_command(&f->cal, &f->imu, cmd, f->rest, f->noise))
+        {
+            case CALIB_RECALIBRATED:
+                strike_init(&f->strike, f->role, &f->imu, &f->cal, f->rest, f->noise);
+                break;
+            case CALIB_SENSITIVITY:
+                detector_set_sensitivity(&f->strike.det, f->cal.sensitivity);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+int main(void)
+{
+    uart_init();
+    power_init(0);
+    trace_init(&feet[FOOT_KICK].imu, hc05_link_setup(HC05_LINK_BAUD));
+
+    LED_DDR |= (1 << LED_PIN);
+    LED_PORT &= ~(1 << LED_PIN);
+
+    for (uint8_t i = 0; i < FEET; i++)
+    {
+        foot_t *f = &feet[i];
+
+        if (imu_open(&f->imu, f->addr) < 0 || imu_set_rate(&f->imu, f->role->odr, IMU_ODR_OFF) < 0)
+        {
+            while (1);
+        }
+
+        if (calib_boot(&f->cal, &f->imu, f->role->det.noise_mult, f->rest, f->noise) < 0)
+        {
+            while (1);
+        }
+        strike_init(&f->strike, f->role, &f->imu, &f->cal, f->rest, f->noise);
+        power_add_imu(&f->imu);
+    }
+
+    sched_init();
+    prof_init(HIT_PAD_KICK);
+    hc05_selftest(&link);
+    prof_set_link(link.rtt_avg, link.lost);
+    detect_id = sched_add(detect_task, SAMPLE_PERIOD_MS);   // first task = highest priority
+    sched_add(trace_task, TRACE_PERIOD_MS);
+    led_off_task = sched_add(led_off, 0);
+    sched_add(command_task, COMMAND_PERIOD_MS);
+    sched_add(power_task, POWER_POLL_MS);
+    sched_add(prof_task, PROF_TASK_MS);                     // lowest priority
+    power_standby_init(detect_id);
+    prof_set_detect_task(detect_id);
+
+    while (1)
+    {
+        if (!sched_run())
+        {
+            sched_sleep();
+        }
+    }
+}
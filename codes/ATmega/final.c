@@ -8,12 +8,24 @@
 #include "uart.h"
 #include "i2c.h"
 #include "imu.h"
+#include "fmt.h"
+#include "strike.h"
+#include "calib.h"
+#include "roles.h"
+#include "hc05.h"
+#include "trace.h"
+#include "prof.h"
+#include "power.h"
+#include "stream.h"
+#include "sched.h"
+#include "display.h"
 #include "ST7735.h"
 #include "LCD_GFX.h"
 
 
-#define STRIKE_THRESHOLD    1.8f
-#define RESET_THRESHOLD    -0.2f
+#define STRIKE_SHOW_MS      150       // How long the strike banner stays up
+#define COMMAND_PERIOD_MS   50
+#define DISPLAY_PERIOD_MS   2
 
 #define LED_PORT    PORTB
 #define LED_DDR     DDRB
@@ -35,69 +47,132 @@
 #define DRUM_LABEL_Y 25
 #define STRIKE_LINE_Y 100 
 
-typedef enum {
-    WAITING_FOR_STRIKE = 0,
-    STRIKE_DETECTED_WAIT_UP = 1
-} strike_state_t;
+#define STRIKE_CHARS  7               // "STRIKE!"
+#define IMPACT_CHARS  16              // "Impact: -x.xx g"
+
+static const strike_role_t role = ROLE_FINAL_KICK;
+
+static imu_t imu;
+static calib_t cal;
+static int16_t rest[3], noise[3];
+static strike_t strike;
+static hc05_test_t link;         // boot self-test result
+
+static uint8_t detect_id;
+static uint8_t clear_task;
+static uint8_t strike_field;
+static uint8_t impact_field;
 
 
 
 
 static void draw_static_info(void) {
   
-    LCD_drawBlock(0, 0, LCD_WIDTH - 1, 15, COL_BG);
     LCD_drawString(2, HEADER_Y, "V-DRUMS TRIGGER", COL_FG, COL_BG);
 
   
-    LCD_drawBlock(0, DRUM_LABEL_Y, LCD_WIDTH - 1, DRUM_LABEL_Y + 15, COL_BG);
     LCD_drawString(2, DRUM_LABEL_Y, "PAD:", COL_FG, COL_BG);
     LCD_drawString(35, DRUM_LABEL_Y, "SNARE", COL_ACCENT, COL_BG);
-}
 
+    display_init();
+    strike_field = display_add_field((LCD_WIDTH - STRIKE_CHARS * DISPLAY_CHAR_W) / 2, STRIKE_LINE_Y + 3,
+                                     STRIKE_CHARS, COL_FG, COL_BG);
+    impact_field = display_add_field((LCD_WIDTH - IMPACT_CHARS * DISPLAY_CHAR_W) / 2, STRIKE_LINE_Y + 20,
+                                     IMPACT_CHARS, COL_FG, COL_BG);
+}
 
-static void display_strike_message(bool show, float az) {
-    
 
-    uint8_t text_y = STRIKE_LINE_Y;
+/* The banner is two text fields; showing and clearing only recolours them */
+static void display_strike_message(bool show, int16_t az) {
     
- 
-    const uint8_t STRIKE_WIDTH_PIXELS = 6 * 7; 
-
     if (show) {
         char buf[20];
+        uint8_t len = 8;
+        memcpy(buf, "Impact: ", len);
+        len += fmt_raw_g(buf + len, az, 2);
+        memcpy(buf + len, " g", 3);
         
-
-        LCD_drawBlock(0, text_y - 5, LCD_WIDTH - 1, LCD_HEIGHT - 1, COL_IMPACT);
+        display_set_colors(strike_field, COL_BG, COL_IMPACT);
+        display_set_text(strike_field, "STRIKE!");
+        display_set_colors(impact_field, COL_BG, COL_IMPACT);
+        display_set_text(impact_field, buf);
         
+        sched_start(clear_task, STRIKE_SHOW_MS);
+    } else {
+        display_set_colors(strike_field, COL_FG, COL_BG);
+        display_set_text(strike_field, "");
+        display_set_colors(impact_field, COL_FG, COL_BG);
+        display_set_text(impact_field, "");
+    }
+}
 
-        LCD_drawString((LCD_WIDTH/2) - (STRIKE_WIDTH_PIXELS / 2), text_y + 3, "STRIKE!", COL_BG, COL_IMPACT);
-        
-   
-        snprintf(buf, sizeof(buf), "Impact: %.2f g", az);
-        
+static void clear_banner(void) {
+    display_strike_message(false, 0);
+}
 
-        uint8_t impact_width_pixels = 6 * (uint8_t)strlen(buf);
-        LCD_drawString((LCD_WIDTH/2) - (impact_width_pixels / 2), text_y + 20, buf, COL_BG, COL_IMPACT);
-        
+static void detect_task(void)
+{
+    uint8_t events = trace_strike_poll(&strike);
 
-        _delay_ms(150);
-        
+    if (events & DET_EVENT_ONSET)
+    {
+        power_hit();
+        LED_PORT |= (1 << LED_PIN);
+    }
 
-        LCD_drawBlock(0, text_y - 5, LCD_WIDTH - 1, LCD_HEIGHT - 1, COL_BG);
-    } 
+    if (events & DET_EVENT_PEAK)
+    {
+        display_strike_message(true, strike.amplitude);
+    }
+    else if (strike.det.state == DET_ARMED)
+    {
+        LED_PORT &= ~(1 << LED_PIN);
+    }
+}
+
+static void display_task(void)
+{
+    prof_t t = PROF_BEGIN();
+
+    display_service();
+    PROF_END(PROF_DISPLAY, t);
+}
+
+static void command_task(void)
+{
+    int cmd = uart_try_receive();
+
+    if (trace_command(cmd) || prof_command(cmd) || stream_command(cmd))
+    {
+        return;
+    }
+
+    switch (calib_command(&cal, &imu, cmd, rest, noise))
+    {
+        case CALIB_RECALIBRATED:
+            strike_init(&strike, &role, &imu, &cal, rest, noise);
+            break;
+        case CALIB_SENSITIVITY:
+            detector_set_sensitivity(&strike.det, cal.sensitivity);
+            break;
+        default:
+            break;
+    }
 }
 
 int main(void)
 {
 
     uart_init();
+    power_init(POWER_KEEP_SPI);
+    trace_init(&imu, hc05_link_setup(HC05_LINK_BAUD));
     
 
     LED_DDR |= (1 << LED_PIN);
     PORTB &= ~(1 << LED_PIN); 
 
 
-    if (IMU_init(0x6B) < 0)
+    if (imu_open(&imu, IMU_ADDR_HIGH) < 0 || imu_set_rate(&imu, role.odr, IMU_ODR_OFF) < 0)
     {
         printf("ERROR: IMU not found!\r\n");
         while (1);
@@ -115,42 +190,35 @@ int main(void)
     draw_static_info();
     
 
-    uint8_t buf[6];
-    float az;
-    strike_state_t state = WAITING_FOR_STRIKE;
+    if (calib_boot(&cal, &imu, role.det.noise_mult, rest, noise) < 0)
+    {
+        printf("ERROR: calibration failed!\r\n");
+        while (1);
+    }
+    strike_init(&strike, &role, &imu, &cal, rest, noise);
+
+    power_add_imu(&imu);
+    sched_init();
+    prof_init(role.pad);
+    hc05_selftest(&link);
+    prof_set_link(link.rtt_avg, link.lost);
+    detect_id = sched_add(detect_task, role.sample_period_ms);   // first task = highest priority
+    sched_add(stream_task, role.sample_period_ms);
+    sched_add(trace_task, TRACE_PERIOD_MS);
+    clear_task = sched_add(clear_banner, 0);
+    sched_add(command_task, COMMAND_PERIOD_MS);
+    sched_add(display_task, DISPLAY_PERIOD_MS);
+    sched_add(power_task, POWER_POLL_MS);
+    sched_add(prof_task, PROF_TASK_MS);                          // lowest priority
+    power_standby_init(detect_id);
+    prof_set_detect_task(detect_id);
+    stream_init(&imu, role.pad, role.sample_period_ms, detect_id, 0);
 
     while (1)
     {
-
-        if (IMU_readAccBytes(buf) == 0)
+        if (!sched_run())
         {
-            int16_t raw_z = (int16_t)((buf[5] << 8) | buf[4]);
-            az = raw_z / 4096.0f; 
-
-            switch(state)
-            {
-                case WAITING_FOR_STRIKE:
-                    if (az > STRIKE_THRESHOLD)
-                    {
-                        LED_PORT |= (1 << LED_PIN);
-                        uart_send('3', NULL); 
-                        
-                        
-                        display_strike_message(true, az);
-                        
-                        state = STRIKE_DETECTED_WAIT_UP;
-                    }
-                    break;
-
-                case STRIKE_DETECTED_WAIT_UP:
-                    if (az < RESET_THRESHOLD)
-                    {
-                        LED_PORT &= ~(1 << LED_PIN);
-                        state = WAITING_FOR_STRIKE;
-                    }
-                    break;
-            }
+            sched_sleep();
         }
-        _delay_ms(20); 
     }
 }
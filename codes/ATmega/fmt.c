@@ -0,0 +1,69 @@
+#include "fmt.h"
+#include "imu.h"
+
+uint8_t fmt_uint(char *buf, uint32_t value)
+{
+    char tmp[10];
+    uint8_t n = 0;
+    uint8_t len = 0;
+
+    do {
+        tmp[n++] = (char)('0' + (value % 10));
+        value /= 10;
+    } while (value);
+
+    while (n)
+        buf[len++] = tmp[--n];
+
+    buf[len] = '\0';
+    return len;
+}
+
+uint8_t fmt_fixed(char *buf, int32_t value, uint8_t decimals)
+{
+    uint8_t len = 0;
+    uint32_t mag;
+    uint32_t scale = 1;
+
+    if (value < 0) {
+        buf[len++] = '-';
+        mag = (uint32_t)(-(value + 1)) + 1;
+    } else {
+        mag = (uint32_t)value;
+    }
+
+    for (uint8_t i = 0; i < decimals; i++)
+        scale *= 10;
+
+    len += fmt_uint(buf + len, mag / scale);
+
+    if (decimals) {
+        uint32_t frac = mag % scale;
+
+        buf[len++] = '.';
+        for (uint8_t i = decimals; i > 0; i--) {
+            buf[len + i - 1] = (char)('0' + (frac % 10));
+            frac /= 10;
+        }
+        len += decimals;
+        buf[len] = '\0';
+    }
+
+    return len;
+}
+
+uint8_t fmt_raw_g(char *buf, int16_t raw, uint8_t decimals)
+{
+    int32_t scaled = raw;
+
+    if (decimals > 3)
+        decimals = 3;
+
+    for (uint8_t i = 0; i < decimals; i++)
+        scaled *= 10;
+
+    /* round half away from zero before the (power of two) divide */
+    scaled += (scaled < 0) ? -(IMU_ACC_LSB_PER_G / 2) : (IMU_ACC_LSB_PER_G / 2);
+
+    return fmt_fixed(buf, scaled / IMU_ACC_LSB_PER_G, decimals);
+}
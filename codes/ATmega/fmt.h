@@ -0,0 +1,21 @@
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdint.h>
+
+/*
+ * Integer-only decimal formatting for the LCD and UART telemetry.
+ * Avoids pulling the floating point printf library into the node image.
+ * Every function NUL-terminates buf and returns the number of characters written.
+ */
+
+/* Unsigned decimal, buf needs 11 bytes */
+uint8_t fmt_uint(char *buf, uint32_t value);
+
+/* value / 10^decimals with a fixed number of decimals, e.g. (-125, 2) -> "-1.25" */
+uint8_t fmt_fixed(char *buf, int32_t value, uint8_t decimals);
+
+/* Raw accelerometer counts as g, rounded to 0..3 decimals, e.g. (6144, 2) -> "1.50" */
+uint8_t fmt_raw_g(char *buf, int16_t raw, uint8_t decimals);
+
+#endif /* FMT_H */
@@ -0,0 +1,83 @@
+#include "gravity.h"
+
+static int16_t sat16(int32_t v)
+{
+    if (v > INT16_MAX) return INT16_MAX;
+    if (v < INT16_MIN) return INT16_MIN;
+    return (int16_t)v;
+}
+
+static uint16_t abs16(int16_t v)
+{
+    return (v < 0) ? (uint16_t)(-(int32_t)v) : (uint16_t)v;
+}
+
+uint16_t gravity_magnitude(int16_t x, int16_t y, int16_t z)
+{
+    uint16_t a = abs16(x), b = abs16(y), c = abs16(z), t;
+
+    /* sort so that a >= b >= c */
+    if (a < b) { t = a; a = b; b = t; }
+    if (b < c) { t = b; b = c; c = t; }
+    if (a < b) { t = a; a = b; b = t; }
+
+    /* max + 11/32 mid + 1/4 min */
+    uint32_t m = (uint32_t)a + (((uint32_t)b * 11) >> 5) + (c >> 2);
+    return (m > UINT16_MAX) ? UINT16_MAX : (uint16_t)m;
+}
+
+void gravity_init(gravity_t *gv, const int16_t rest[3], const int16_t swing_dir[3])
+{
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        gv->g_acc[i] = (int32_t)rest[i] << GRAV_SHIFT;
+        gv->swing_acc[i] = swing_dir[i];
+        gv->dir[i] = swing_dir[i];
+        gv->dyn[i] = 0;
+        gv->prev_dyn[i] = 0;
+    }
+}
+
+int16_t gravity_update(gravity_t *gv, const int16_t acc[3], uint8_t track)
+{
+    int32_t proj = 0;
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        int16_t g = (int16_t)(gv->g_acc[i] >> GRAV_SHIFT);
+
+        if (track)
+            gv->g_acc[i] += acc[i] - g;
+
+        gv->prev_dyn[i] = gv->dyn[i];
+        gv->dyn[i] = sat16((int32_t)acc[i] - g);
+        proj += (int32_t)gv->dyn[i] * gv->dir[i];
+    }
+
+    return sat16(proj >> 14);
+}
+
+void gravity_learn(gravity_t *gv)
+{
+    const int16_t *v = gv->prev_dyn;
+    uint16_t mag = gravity_magnitude(v[0], v[1], v[2]);
+    int32_t s[3];
+
+    if (mag == 0)
+        return;
+
+    /* each strike contributes a unit vector, so hard hits don't dominate */
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        int32_t unit = ((int32_t)v[i] * GRAV_UNIT) / mag;
+        gv->swing_acc[i] += (unit - gv->swing_acc[i]) >> GRAV_DIR_SHIFT;
+        s[i] = gv->swing_acc[i];
+    }
+
+    mag = gravity_magnitude((int16_t)s[0], (int16_t)s[1], (int16_t)s[2]);
+    if (mag < GRAV_UNIT / 4)
+        return;     // strikes disagree too much, keep the old direction
+
+    for (uint8_t i = 0; i < 3; i++)
+        gv->dir[i] = (int16_t)((s[i] * GRAV_UNIT) / mag);
+}
@@ -0,0 +1,231 @@
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+#include <avr/io.h>
+#include <util/delay.h>
+#include <string.h>
+#include "hc05.h"
+#include "uart.h"
+#include "sched.h"
+
+#define HC05_AT_BAUD_FULL   38400UL     // rate when KEY is high at power-up
+#define HC05_KEY_SETTLE_MS  50
+#define HC05_REPLY_MS       300
+#define HC05_RESTART_MS     1000
+#define HC05_REPLY_CHARS    16
+#define HC05_BURST_TIMEOUT  1000        // ms, covers the burst at 9600 baud
+
+static const uint32_t probe_bauds[] = {
+    UART_BAUD_RATE, HC05_LINK_BAUD, HC05_AT_BAUD_FULL
+};
+
+static void key_set(uint8_t on)
+{
+    if (on)
+        HC05_KEY_PORT |= (1 << HC05_KEY_PIN);
+    else
+        HC05_KEY_PORT &= ~(1 << HC05_KEY_PIN);
+    _delay_ms(HC05_KEY_SETTLE_MS);
+}
+
+static void send_string(const char *s)
+{
+    while (*s)
+        uart_send(*s++, NULL);
+}
+
+static void drain_rx(void)
+{
+    while (uart_try_receive() >= 0);
+}
+
+/* Send one AT command and wait for its reply line. Returns 0 on "OK". */
+static int at_command(const char *cmd)
+{
+    char reply[HC05_REPLY_CHARS];
+    uint8_t len = 0;
+    uint16_t ticks = HC05_REPLY_MS;
+    int c;
+
+    drain_rx();
+    send_string(cmd);
+    send_string("\r\n");
+
+    while (ticks)
+    {
+        c = uart_try_receive();
+        if (c < 0)
+        {
+            _delay_ms(1);
+            ticks--;
+            continue;
+        }
+        if (c == '\n')
+        {
+            reply[len] = '\0';
+            return strncmp(reply, "OK", 2) == 0 ? 0 : -1;
+        }
+        if (c != '\r' && len < HC05_REPLY_CHARS - 1)
+            reply[len++] = (char)c;
+    }
+    return -1;
+}
+
+/* Find the rate the module answers AT on. Returns 0 if none did. */
+static uint32_t probe(void)
+{
+    for (uint8_t i = 0; i < sizeof(probe_bauds) / sizeof(probe_bauds[0]); i++)
+    {
+        uart_set_baud(probe_bauds[i]);
+        // The first command after a rate change can be garbled, so try twice
+        if (at_command("AT") == 0 || at_command("AT") == 0)
+            return probe_bauds[i];
+    }
+    return 0;
+}
+
+static int program(uint32_t baud)
+{
+    char cmd[24] = "AT+UART=";
+    char digits[8];
+    uint8_t n = 0;
+
+    do {
+        digits[n++] = '0' + baud % 10;
+        baud /= 10;
+    } while (baud);
+    for (uint8_t i = strlen(cmd); n; i++)
+        cmd[i] = digits[--n];
+    strcat(cmd, ",0,0");            // 1 stop bit, no parity
+
+    if (at_command(cmd) < 0)
+        return -1;
+
+    // Settings apply after a restart; release KEY so it comes back in data mode
+    send_string("AT+RESET\r\n");
+    uart_flush(HC05_REPLY_MS);
+    key_set(0);
+    _delay_ms(HC05_RESTART_MS);
+    return 0;
+}
+
+uint32_t hc05_link_setup(uint32_t baud)
+{
+    uint32_t current;
+
+    HC05_KEY_DDR |= (1 << HC05_KEY_PIN);
+    key_set(1);
+
+    current = probe();
+    if (current == 0)
+    {
+        // No AT reply at all, assume the module is still at the default rate
+        key_set(0);
+        uart_set_baud(UART_BAUD_RATE);
+        return UART_BAUD_RATE;
+    }
+
+    if (current != baud)
+    {
+        if (program(baud) < 0)
+        {
+            // Still at current; fall back to the default rate rather than run there
+            if (current != UART_BAUD_RATE)
+                program(UART_BAUD_RATE);
+            key_set(0);
+            uart_set_baud(UART_BAUD_RATE);
+            return UART_BAUD_RATE;
+        }
+
+        // Check the module now answers at the new rate
+        key_set(1);
+        uart_set_baud(baud);
+        if (at_command("AT") < 0 && at_command("AT") < 0)
+        {
+            current = probe();
+            if (current != UART_BAUD_RATE && current != 0)
+                program(UART_BAUD_RATE);
+            key_set(0);
+            uart_set_baud(UART_BAUD_RATE);
+            return UART_BAUD_RATE;
+        }
+    }
+
+    key_set(0);
+    drain_rx();
+    return baud;
+}
+
+/* Wait for the pong to seq, discarding anything else. Returns the RTT or -1. */
+static int32_t wait_pong(uint8_t seq, uint16_t start, uint16_t timeout)
+{
+    uint8_t got_pong = 0;
+    int c;
+
+    while ((uint16_t)(sched_now() - start) < timeout)
+    {
+        c = uart_try_receive();
+        if (c < 0)
+            continue;
+        if (got_pong && c == seq)
+            return (uint16_t)(sched_now() - start);
+        got_pong = (c == LINK_PONG);
+    }
+    return -1;
+}
+
+int hc05_selftest(hc05_test_t *result)
+{
+    uint32_t sum = 0;
+    uint8_t answered = 0;
+    uint16_t start;
+    int32_t rtt;
+
+    result->rtt_min = 0xFFFF;
+    result->rtt_max = 0;
+    result->bytes_per_s = 0;
+    result->lost = 0;
+    drain_rx();
+
+    for (uint8_t seq = 0; seq < HC05_TEST_PINGS; seq++)
+    {
+        start = sched_now();
+        uart_send(LINK_PING, NULL);
+        uart_send(seq, NULL);
+        rtt = wait_pong(seq, start, HC05_TEST_TIMEOUT);
+        if (rtt < 0)
+        {
+            result->lost++;
+            continue;
+        }
+        answered++;
+        sum += rtt;
+        if (rtt < result->rtt_min)
+            result->rtt_min = rtt;
+        if (rtt > result->rtt_max)
+            result->rtt_max = rtt;
+    }
+
+    if (answered == 0)
+    {
+        result->rtt_min = 0;
+        result->rtt_avg = 0;
+        return -1;
+    }
+    result->rtt_avg = sum / answered;
+
+    // The pong to a ping queued behind the burst arrives once the burst has
+    // crossed the link; one minimum RTT of that time is not transfer time
+    start = sched_now();
+    uart_send(LINK_BURST, NULL);
+    uart_send(HC05_TEST_BURST, NULL);
+    for (uint8_t i = 0; i < HC05_TEST_BURST; i++)
+        uart_send(0x55, NULL);
+    uart_send(LINK_PING, NULL);
+    uart_send(HC05_TEST_PINGS, NULL);
+    rtt = wait_pong(HC05_TEST_PINGS, start, HC05_BURST_TIMEOUT);
+    if (rtt > result->rtt_min)
+        result->bytes_per_s = (uint32_t)(HC05_TEST_BURST + 4) * 1000 / (rtt - result->rtt_min);
+
+    return 0;
+}
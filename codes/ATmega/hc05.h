@@ -0,0 +1,59 @@
+#ifndef HC05_H
+#define HC05_H
+
+#include <stdint.h>
+
+/*
+ * Boot-time setup of the HC-05 serial link.
+ *
+ * The node raises the module's KEY pin to enter AT mode, finds the baud rate
+ * the module is currently set to, programs HC05_LINK_BAUD and restarts it.
+ * If any step fails both sides stay at (or return to) UART_BAUD_RATE.
+ *
+ * The hub answers LINK_PING with LINK_PONG and the same sequence byte on
+ * whichever link the ping came from, and discards the payload of a
+ * LINK_BURST. None of these bytes collide with the hit protocol in hit.h.
+ */
+
+/* KEY (EN) pin of the HC-05, held high while sending AT commands */
+#define HC05_KEY_DDR        DDRD
+#define HC05_KEY_PORT       PORTD
+#define HC05_KEY_PIN        PD4
+
+/*
+ * 115200 is the fastest rate within 2.5% at 16 MHz (U2X, UBRR 16);
+ * 230400 and 460800 are 3.5% and 8.5% off and are not reliable.
+ */
+#define HC05_LINK_BAUD      115200UL
+
+#define LINK_PING           0xE0    // followed by a sequence byte
+#define LINK_PONG           0xE1    // echo of the ping's sequence byte
+#define LINK_BURST          0xE2    // followed by a length byte and that many filler bytes
+
+#define HC05_TEST_PINGS     8
+#define HC05_TEST_BURST     240     // bytes in the throughput burst
+#define HC05_TEST_TIMEOUT   250     // ms to wait for each pong
+
+typedef struct {
+    uint32_t baud;                  // node UART rate in use
+    uint16_t rtt_min;               // round trip, ms
+    uint16_t rtt_avg;
+    uint16_t rtt_max;
+    uint16_t bytes_per_s;           // one-way throughput of the burst
+    uint8_t lost;                   // pings without a pong
+} hc05_test_t;
+
+/*
+ * Negotiate the link rate. Needs uart_init() (interrupts on) but not the
+ * scheduler. Returns the baud rate the node UART was left at.
+ */
+uint32_t hc05_link_setup(uint32_t baud);
+
+/*
+ * Ping the hub and time a burst. Needs sched_init() for the millisecond
+ * clock and must run before other tasks read the UART. Returns 0 if the hub
+ * answered, -1 if every ping was lost.
+ */
+int hc05_selftest(hc05_test_t *result);
+
+#endif /* HC05_H */
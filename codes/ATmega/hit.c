@@ -0,0 +1,25 @@
+#include <stdio.h>
+#include "hit.h"
+#include "uart.h"
+
+void hit_send(char pad)
+{
+    uart_send(pad, NULL);
+}
+
+void hit_send_velocity(char pad, uint8_t velocity)
+{
+    uart_send((char)(HIT_VELOCITY_FLAG | (pad - '0')), NULL);
+    uart_send((char)(0x80 | (velocity & 0x7F)), NULL);
+}
+
+const char *hit_pad_name(char pad)
+{
+    switch (pad)
+    {
+        case HIT_PAD_SNARE: return "SNARE";
+        case HIT_PAD_HIHAT: return "HIHAT";
+        case HIT_PAD_KICK:  return "KICK";
+        default:            return "?";
+    }
+}
@@ -0,0 +1,33 @@
+#ifndef HIT_H
+#define HIT_H
+
+#include <stdint.h>
+
+/*
+ * Node -> hub hit messages over the HC-05 link.
+ *
+ * A hit is first sent as the single pad character at strike onset, which
+ * older hub firmware already understands. Once the peak is known a 2-byte
+ * follow-up carries the velocity:
+ *
+ *     HIT_VELOCITY_FLAG | pad number,  0x80 | velocity (1..127)
+ *
+ * Both follow-up bytes have the top bit set, which the pad characters never
+ * do, so a hub that ignores them loses nothing but the dynamics. The byte
+ * after a flag byte is always the velocity, even if it looks like a flag.
+ */
+
+#define HIT_PAD_SNARE       '1'
+#define HIT_PAD_HIHAT       '2'
+#define HIT_PAD_KICK        '3'
+
+#define HIT_VELOCITY_FLAG   0xF0
+
+void hit_send(char pad);
+
+void hit_send_velocity(char pad, uint8_t velocity);
+
+/* Upper-case pad name for the LCD, e.g. "SNARE" */
+const char *hit_pad_name(char pad);
+
+#endif /* HIT_H */
@@ -6,85 +6,216 @@
 
 #define LSM_WHO_AM_I      0x0F
 #define LSM_CTRL1_XL      0x10
+#define LSM_CTRL2_G       0x11
 #define LSM_CTRL3_C       0x12
 #define LSM_CTRL9_XL      0x18
-#define LSM_STATUS        0x17
+#define LSM_STATUS        0x1E
+#define LSM_WAKE_UP_SRC   0x1B
+#define LSM_TAP_CFG0      0x56
+#define LSM_TAP_CFG2      0x58
+#define LSM_WAKE_UP_THS   0x5B
+#define LSM_WAKE_UP_DUR   0x5C
+#define LSM_MD1_CFG       0x5E
+#define LSM_OUTX_L_G      0x22
 #define LSM_OUTX_L_XL     0x28
 
+#define LSM_FS_XL_8G      0x0C
+#define LSM_FS_G_2000DPS  0x0C
+#define LSM_LIR           0x01      // TAP_CFG0: latch event flags until read
+#define LSM_INT_ENABLE    0x80      // TAP_CFG2: enable the embedded functions
+#define LSM_INT1_WU       0x20      // MD1_CFG: wake-up event on INT1
+#define LSM_WU_IA         0x08      // WAKE_UP_SRC: wake-up event
+
 
 #define LSM6_WHO_AM_I_VAL 0x6C
 
 #define LSM6_ACCEL_16G_LSB_mg   (0.488f)   
 
-static uint8_t imu_addr = 0x00; 
+static imu_t imu_default;
 
-int IMU_init(uint8_t addr7)
+int imu_open(imu_t *imu, uint8_t addr7)
 {
-    imu_addr = addr7;
+    imu->addr = addr7;
+    imu->acc_odr = IMU_ODR_104HZ;
+    imu->gyro_odr = IMU_ODR_OFF;
     I2C_init();
     _delay_ms(5);
 
     uint8_t who;
-    if (I2C_readRegister(imu_addr, LSM_WHO_AM_I, &who) != 0)
+    if (I2C_readRegister(imu->addr, LSM_WHO_AM_I, &who) != 0)
         return -1;
 
     if (who != LSM6_WHO_AM_I_VAL)
         return -1;
 
-    if (I2C_writeRegister(imu_addr, LSM_CTRL3_C, 0x44) != 0)
+    if (I2C_writeRegister(imu->addr, LSM_CTRL3_C, 0x44) != 0)
         return -1;
 
 
-    if (I2C_writeRegister(imu_addr, LSM_CTRL1_XL, 0x4C) != 0)
+    if (I2C_writeRegister(imu->addr, LSM_CTRL1_XL, IMU_ODR_104HZ | LSM_FS_XL_8G) != 0)
         return -1;
 
 
-    if (I2C_writeRegister(imu_addr, LSM_CTRL9_XL, 0x38) != 0)
+    if (I2C_writeRegister(imu->addr, LSM_CTRL9_XL, 0x38) != 0)
         return -1;
 
     _delay_ms(20);
     return 0;
 }
 
-uint8_t IMU_getAddress(void)
+int imu_set_rate(imu_t *imu, uint8_t acc_odr, uint8_t gyro_odr)
 {
-    return imu_addr;
+    if (I2C_writeRegister(imu->addr, LSM_CTRL1_XL, acc_odr | LSM_FS_XL_8G) != 0)
+        return -1;
+
+    if (I2C_writeRegister(imu->addr, LSM_CTRL2_G, gyro_odr ? (gyro_odr | LSM_FS_G_2000DPS) : 0) != 0)
+        return -1;
+
+    imu->acc_odr = acc_odr;
+    imu->gyro_odr = gyro_odr;
+
+    return 0;
 }
 
-int IMU_checkNewData(void)
+int imu_new_data(const imu_t *imu)
 {
     uint8_t st = 0;
 
-    if (I2C_readRegister(imu_addr, LSM_STATUS, &st) != 0)
+    if (I2C_readRegister(imu->addr, LSM_STATUS, &st) != 0)
         return 0;
 
     return (st & 0x01) ? 1 : 0;
 }
 
-int IMU_readAccBytes(uint8_t buf[6])
+int imu_read_acc_bytes(const imu_t *imu, uint8_t buf[6])
 {
     if (!buf) return -1;
 
-    if (I2C_readMulti(imu_addr, LSM_OUTX_L_XL, buf, 6) != 0)
+    if (I2C_readMulti(imu->addr, LSM_OUTX_L_XL, buf, 6) != 0)
         return -1;
 
     return 0;
 }
 
-int IMU_readAccRaw(int16_t *ax, int16_t *ay, int16_t *az)
+int imu_read_acc(const imu_t *imu, int16_t acc[3])
 {
     uint8_t b[6];
 
-    if (IMU_readAccBytes(b) < 0)
+    if (imu_read_acc_bytes(imu, b) < 0)
+        return -1;
+
+    acc[0] = (int16_t)((b[1] << 8) | b[0]);
+    acc[1] = (int16_t)((b[3] << 8) | b[2]);
+    acc[2] = (int16_t)((b[5] << 8) | b[4]);
+
+    return 0;
+}
+
+int imu_read_acc_gyro(const imu_t *imu, int16_t acc[3], int16_t gyro[3])
+{
+    uint8_t b[12];
+
+    if (I2C_readMulti(imu->addr, LSM_OUTX_L_G, b, 12) != 0)
         return -1;
 
-    *ax = (int16_t)((b[1] << 8) | b[0]);
-    *ay = (int16_t)((b[3] << 8) | b[2]);
-    *az = (int16_t)((b[5] << 8) | b[4]);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        gyro[i] = (int16_t)((b[2 * i + 1] << 8) | b[2 * i]);
+        acc[i] = (int16_t)((b[2 * i + 7] << 8) | b[2 * i + 6]);
+    }
 
     return 0;
 }
 
+int imu_wakeup_arm(const imu_t *imu, uint8_t threshold)
+{
+    uint8_t on = threshold ? 1 : 0;
+
+    if (I2C_writeRegister(imu->addr, LSM_WAKE_UP_THS, threshold & 0x3F) != 0)
+        return -1;
+
+    if (I2C_writeRegister(imu->addr, LSM_WAKE_UP_DUR, 0) != 0)
+        return -1;
+
+    if (I2C_writeRegister(imu->addr, LSM_TAP_CFG0, on ? LSM_LIR : 0) != 0)
+        return -1;
+
+    if (I2C_writeRegister(imu->addr, LSM_MD1_CFG, on ? LSM_INT1_WU : 0) != 0)
+        return -1;
+
+    if (I2C_writeRegister(imu->addr, LSM_TAP_CFG2, on ? LSM_INT_ENABLE : 0) != 0)
+        return -1;
+
+    return 0;
+}
+
+int imu_wakeup_pending(const imu_t *imu)
+{
+    uint8_t src = 0;
+
+    if (I2C_readRegister(imu->addr, LSM_WAKE_UP_SRC, &src) != 0)
+        return 0;
+
+    return (src & LSM_WU_IA) ? 1 : 0;
+}
+
+int imu_read_acc_pair(const imu_t *a, const imu_t *b, int16_t acc_a[3], int16_t acc_b[3])
+{
+    int ra = imu_read_acc(a, acc_a);
+    int rb = imu_read_acc(b, acc_b);
+
+    return (ra < 0 || rb < 0) ? -1 : 0;
+}
+
+int IMU_init(uint8_t addr7)
+{
+    return imu_open(&imu_default, addr7);
+}
+
+imu_t *IMU_device(void)
+{
+    return &imu_default;
+}
+
+uint8_t IMU_getAddress(void)
+{
+    return imu_default.addr;
+}
+
+int IMU_setRate(uint8_t acc_odr, uint8_t gyro_odr)
+{
+    return imu_set_rate(&imu_default, acc_odr, gyro_odr);
+}
+
+int IMU_checkNewData(void)
+{
+    return imu_new_data(&imu_default);
+}
+
+int IMU_readAccBytes(uint8_t buf[6])
+{
+    return imu_read_acc_bytes(&imu_default, buf);
+}
+
+int IMU_readAccRaw(int16_t *ax, int16_t *ay, int16_t *az)
+{
+    int16_t acc[3];
+
+    if (imu_read_acc(&imu_default, acc) < 0)
+        return -1;
+
+    *ax = acc[0];
+    *ay = acc[1];
+    *az = acc[2];
+
+    return 0;
+}
+
+int IMU_readAccGyroRaw(int16_t acc[3], int16_t gyro[3])
+{
+    return imu_read_acc_gyro(&imu_default, acc, gyro);
+}
+
 int IMU_readAcc_mg(float *ax_mg, float *ay_mg, float *az_mg)
 {
     int16_t rx, ry, rz;
@@ -3,9 +3,58 @@
 
 #include <stdint.h>
 
+/* LSM6 7-bit addresses, picked by the level on its SDO/SA0 pin */
+#define IMU_ADDR_LOW    0x6A
+#define IMU_ADDR_HIGH   0x6B    // single-sensor nodes
 
+/*
+ * One sensor on the TWI bus. A node can run two LSM6 side by side, one at
+ * each address, each with its own imu_t, calibration and detector.
+ */
+typedef struct {
+    uint8_t addr;
+    uint8_t acc_odr;            // IMU_ODR_* last set, for restoring after a change
+    uint8_t gyro_odr;
+} imu_t;
+
+int imu_open(imu_t *imu, uint8_t addr7);
+
+int imu_set_rate(imu_t *imu, uint8_t acc_odr, uint8_t gyro_odr);
+
+/* 1 if the accelerometer has a sample that was not read yet */
+int imu_new_data(const imu_t *imu);
+
+int imu_read_acc(const imu_t *imu, int16_t acc[3]);
+
+int imu_read_acc_bytes(const imu_t *imu, uint8_t buf[6]);
+
+int imu_read_acc_gyro(const imu_t *imu, int16_t acc[3], int16_t gyro[3]);
+
+/*
+ * Arm the sensor's wake-up (motion) detector with a threshold in steps of
+ * 1/64 of full scale (0.125 g at +/-8 g), latched and also routed to INT1.
+ * threshold 0 disarms it.
+ */
+int imu_wakeup_arm(const imu_t *imu, uint8_t threshold);
+
+/* 1 if motion was seen since the last call (reading clears the latch) */
+int imu_wakeup_pending(const imu_t *imu);
+
+/*
+ * Burst-read both accelerometers back to back, so the two samples are as
+ * close in time as the bus allows. Returns -1 if either read failed; the
+ * other sample is still valid.
+ */
+int imu_read_acc_pair(const imu_t *a, const imu_t *b, int16_t acc_a[3], int16_t acc_b[3]);
+
+/*
+ * Single-sensor API kept for the older sketches: every call acts on the
+ * device opened by IMU_init().
+ */
 int IMU_init(uint8_t addr7);
 
+imu_t *IMU_device(void);
+
 int IMU_checkNewData(void);
 
 int IMU_readAccRaw(int16_t *ax, int16_t *ay, int16_t *az);
@@ -16,6 +65,28 @@ int IMU_readAccBytes(uint8_t buf[6]);
 
 uint8_t IMU_getAddress(void);
 
+/* Output data rates for IMU_setRate(), ODR field of CTRL1_XL / CTRL2_G */
+#define IMU_ODR_OFF     0x00
+#define IMU_ODR_12HZ5   0x10
+#define IMU_ODR_26HZ    0x20
+#define IMU_ODR_104HZ   0x40
+#define IMU_ODR_208HZ   0x50
+#define IMU_ODR_416HZ   0x60
+
+/* Accelerometer stays at +/-8 g; the gyro runs at +/-2000 dps when enabled */
+int IMU_setRate(uint8_t acc_odr, uint8_t gyro_odr);
+
+/* One burst read of gyro then accelerometer, raw counts */
+int IMU_readAccGyroRaw(int16_t acc[3], int16_t gyro[3]);
+
 #define IMU_ACCEL_LSB_mg 0.061f
 
+#define IMU_GYRO_mdps_PER_LSB   70
+
+/* Raw accelerometer counts per g at the +/-8 g full scale set by IMU_init() */
+#define IMU_ACC_LSB_PER_G   4096
+
+/* Threshold in g -> raw counts, folded to an integer constant at compile time */
+#define IMU_G_TO_RAW(g)     ((int16_t)((g) * IMU_ACC_LSB_PER_G))
+
 #endif /* IMU_H */
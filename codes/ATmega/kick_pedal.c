@@ -5,74 +5,112 @@
 #include "uart.h"
 #include "i2c.h"
 #include "imu.h"
+#include "strike.h"
+#include "calib.h"
+#include "roles.h"
+#include "hc05.h"
+#include "trace.h"
+#include "prof.h"
+#include "power.h"
+#include "stream.h"
+#include "sched.h"
 
-#define PEAK_THRESHOLD      0.0f     // Peak must be below -1.0g (downward)
-#define BUFFER_SIZE         3         // Store 3 samples for peak detection
-#define MIN_SAMPLES_BETWEEN 20        // ~100ms gap between taps (
+#define LED_PULSE_MS        50
+#define COMMAND_PERIOD_MS   50
 
 #define LED_PORT   PORTB
 #define LED_DDR    DDRB
 #define LED_PIN    PB5
 
+static const strike_role_t role = ROLE_KICK_PEDAL;
+
+static imu_t imu;
+static calib_t cal;
+static int16_t rest[3], noise[3];
+static strike_t strike;
+static hc05_test_t link;         // boot self-test result
+
+static uint8_t detect_id;
+static uint8_t led_off_task;
+
+static void led_off(void)
+{
+    LED_PORT &= ~(1 << LED_PIN);
+}
+
+static void detect_task(void)
+{
+    if (trace_strike_poll(&strike) & DET_EVENT_ONSET)
+    {
+        power_hit();
+        LED_PORT |= (1 << LED_PIN);
+        sched_start(led_off_task, LED_PULSE_MS);
+    }
+}
+
+static void command_task(void)
+{
+    int cmd = uart_try_receive();
+
+    if (trace_command(cmd) || prof_command(cmd) || stream_command(cmd))
+    {
+        return;
+    }
+
+    switch (calib_command(&cal, &imu, cmd, rest, noise))
+    {
+        case CALIB_RECALIBRATED:
+            strike_init(&strike, &role, &imu, &cal, rest, noise);
+            break;
+        case CALIB_SENSITIVITY:
+            detector_set_sensitivity(&strike.det, cal.sensitivity);
+            break;
+        default:
+            break;
+    }
+}
+
 int main(void)
 {
     uart_init();
+    power_init(0);
+    trace_init(&imu, hc05_link_setup(HC05_LINK_BAUD));
     
     LED_DDR |= (1 << LED_PIN);
     LED_PORT &= ~(1 << LED_PIN);
 
-    if (IMU_init(0x6B) < 0)
+    if (imu_open(&imu, IMU_ADDR_HIGH) < 0 || imu_set_rate(&imu, role.odr, IMU_ODR_OFF) < 0)
+    {
+        while (1);
+    }
+
+    if (calib_boot(&cal, &imu, role.det.noise_mult, rest, noise) < 0)
     {
         while (1);
     }
+    strike_init(&strike, &role, &imu, &cal, rest, noise);
 
-    uint8_t buf[6];
-    float az_buffer[BUFFER_SIZE] = {0};
-    uint8_t buf_index = 0;
-    uint8_t samples_filled = 0;
-    uint16_t samples_since_tap = MIN_SAMPLES_BETWEEN;
+    power_add_imu(&imu);
+    sched_init();
+    prof_init(role.pad);
+    hc05_selftest(&link);
+    prof_set_link(link.rtt_avg, link.lost);
+    detect_id = sched_add(detect_task, role.sample_period_ms);   // first task = highest priority
+    sched_add(stream_task, role.sample_period_ms);
+    sched_add(trace_task, TRACE_PERIOD_MS);
+    led_off_task = sched_add(led_off, 0);
+    sched_add(command_task, COMMAND_PERIOD_MS);
+    sched_add(power_task, POWER_POLL_MS);
+    sched_add(prof_task, PROF_TASK_MS);                          // lowest priority
+    power_standby_init(detect_id);
+    prof_set_detect_task(detect_id);
+    stream_init(&imu, role.pad, role.sample_period_ms, detect_id, 0);
 
     while (1)
     {
-        if (IMU_readAccBytes(buf) == 0)
+        if (!sched_run())
         {
-            int16_t raw_z = (int16_t)((buf[5] << 8) | buf[4]);
-            float az = raw_z / 4096.0f;
-
-
-            az_buffer[buf_index] = az;
-            buf_index = (buf_index + 1) % BUFFER_SIZE;
-            
-            if (samples_filled < BUFFER_SIZE)
-            {
-                samples_filled++;
-            }
-            
-            samples_since_tap++;
-
-            if (samples_filled >= BUFFER_SIZE && samples_since_tap >= MIN_SAMPLES_BETWEEN)
-            {
-                uint8_t prev_idx = (buf_index + BUFFER_SIZE - 2) % BUFFER_SIZE;
-                uint8_t curr_idx = (buf_index + BUFFER_SIZE - 1) % BUFFER_SIZE;
-                uint8_t next_idx = buf_index;
-                
-                float prev = az_buffer[prev_idx];
-                float curr = az_buffer[curr_idx];
-                float next = az_buffer[next_idx];
-                
-             
-                if (curr < PEAK_THRESHOLD && curr < prev && curr < next)
-                {
-                    LED_PORT |= (1 << LED_PIN);
-                    uart_send('3', NULL);
-                    samples_since_tap = 0;
-                    
-                    _delay_ms(50);  
-                    LED_PORT &= ~(1 << LED_PIN);
-                }
-            }
+            sched_sleep();
         }
-
-        _delay_ms(5);  
     }
 }
@@ -8,14 +8,27 @@
 #include "uart.h"
 #include "i2c.h"
 #include "imu.h"
+#include "fmt.h"
+#include "strike.h"
+#include "calib.h"
+#include "roles.h"
+#include "hit.h"
+#include "orient.h"
+#include "hc05.h"
+#include "trace.h"
+#include "prof.h"
+#include "power.h"
+#include "stream.h"
+#include "sched.h"
+#include "display.h"
 #include "ST7735.h"
 #include "LCD_GFX.h"
 
 
-#define PEAK_THRESHOLD      -2.0f     // Peak must be below -2.0g (downward)
-#define BUFFER_SIZE         3         // Store 3 samples for peak detection
-#define MIN_SAMPLES_BETWEEN 3         // ~60ms gap between taps 
 #define AVG_WINDOW_SIZE     10        
+#define LED_PULSE_MS        50
+#define COMMAND_PERIOD_MS   50
+#define DISPLAY_PERIOD_MS   2
 
 #define LED_PORT    PORTB
 #define LED_DDR     DDRB
@@ -41,70 +54,166 @@
 #define HAND_LABEL_Y 45
 #define AVG_LABEL_Y  65
 
+#define STATUS_X     55
+#define AVG_X        35
+#define PAD_X        35
 
-static float strike_history[AVG_WINDOW_SIZE] = {0};
+
+static const orient_config_t zones = LEFT_HAND_ZONES;
+static const strike_role_t role = ROLE_LEFT_HAND_ZONED(&zones);
+
+static imu_t imu;
+static calib_t cal;
+static int16_t rest[3], noise[3];
+static strike_t strike;
+
+static uint8_t detect_id;
+static uint8_t led_off_task;
+static uint8_t status_field;
+static uint8_t pad_field;
+static uint8_t avg_field;
+
+static uint16_t strike_history[AVG_WINDOW_SIZE] = {0};  // raw counts
+static uint32_t strike_sum = 0;
 static uint8_t strike_count = 0;
 static uint8_t strike_index = 0;
 
 
 static void update_status(const char* status, uint16_t color) {
-    LCD_drawBlock(0, STATUS_Y, LCD_WIDTH - 1, STATUS_Y + 15, COL_BG);
-    LCD_drawString(2, STATUS_Y, "STATUS:", COL_FG, COL_BG);
-    LCD_drawString(55, STATUS_Y, status, color, COL_BG);
+    display_set_colors(status_field, color, COL_BG);
+    display_set_text(status_field, status);
 }
 
-static float get_rolling_average(void) {
-    if (strike_count == 0) return 0.0f;
-    
-    float sum = 0.0f;
-    uint8_t count = (strike_count < AVG_WINDOW_SIZE) ? strike_count : AVG_WINDOW_SIZE;
+static int16_t get_rolling_average(void) {
+    if (strike_count == 0) return 0;
     
-    for (uint8_t i = 0; i < count; i++) {
-        sum += strike_history[i];
-    }
-    
-    return sum / count;
+    return (int16_t)(strike_sum / strike_count);
 }
 
 static void update_avg_display(void) {
     char buf[20];
-    float avg = get_rolling_average();
-    
-    LCD_drawBlock(0, AVG_LABEL_Y, LCD_WIDTH - 1, AVG_LABEL_Y + 15, COL_BG);
+    int16_t avg = get_rolling_average();
+    uint8_t len;
     
-    LCD_drawString(2, AVG_LABEL_Y, "AVG:", COL_FG, COL_BG);
-    snprintf(buf, sizeof(buf), "%.2f g", avg);
-    LCD_drawString(35, AVG_LABEL_Y, buf, COL_AVG, COL_BG);
+    len = fmt_raw_g(buf, avg, 2);
+    buf[len++] = ' ';
+    buf[len++] = 'g';
+    buf[len] = '\0';
+    display_set_text(avg_field, buf);
 }
 
+/* Labels never change, so they are drawn once; values live in display fields */
 static void draw_static_info(void) {
-    update_status("INIT...", COL_ACCENT);
+    LCD_drawString(2, STATUS_Y, "STATUS:", COL_FG, COL_BG);
 
-    LCD_drawBlock(0, DRUM_LABEL_Y, LCD_WIDTH - 1, DRUM_LABEL_Y + 15, COL_BG);
     LCD_drawString(2, DRUM_LABEL_Y, "PAD:", COL_FG, COL_BG);
-    LCD_drawString(35, DRUM_LABEL_Y, "HIHAT", COL_ACCENT, COL_BG);
     
-    LCD_drawBlock(0, HAND_LABEL_Y, LCD_WIDTH - 1, HAND_LABEL_Y + 15, COL_BG);
     LCD_drawString(2, HAND_LABEL_Y, "HAND:", COL_FG, COL_BG);
     LCD_drawString(45, HAND_LABEL_Y, "LEFT", COL_ACCENT, COL_BG);
     
+    LCD_drawString(2, AVG_LABEL_Y, "AVG:", COL_FG, COL_BG);
+    
+    display_init();
+    status_field = display_add_field(STATUS_X, STATUS_Y, (LCD_WIDTH - STATUS_X) / DISPLAY_CHAR_W, COL_ACCENT, COL_BG);
+    avg_field = display_add_field(AVG_X, AVG_LABEL_Y, (LCD_WIDTH - AVG_X) / DISPLAY_CHAR_W, COL_AVG, COL_BG);
+    pad_field = display_add_field(PAD_X, DRUM_LABEL_Y, (LCD_WIDTH - PAD_X) / DISPLAY_CHAR_W, COL_ACCENT, COL_BG);
+    display_set_text(pad_field, hit_pad_name(role.pad));
+    
+    update_status("INIT...", COL_ACCENT);
     update_avg_display();
+    display_flush();
 }
 
-static void add_to_average(float force) {
-    strike_history[strike_index] = force;
-    strike_index = (strike_index + 1) % AVG_WINDOW_SIZE;
+/* Time the link to the hub and show the round trip next to READY */
+static void show_link_status(void) {
+    hc05_test_t test;
+    char buf[DISPLAY_FIELD_CHARS + 1] = "READY ";
+    uint8_t len = 6;
     
+    int err = hc05_selftest(&test);
+    
+    prof_set_link(test.rtt_avg, test.lost);
+    if (err < 0) {
+        update_status("READY NO HUB", COL_ERROR);
+        return;
+    }
+    len += fmt_uint(buf + len, test.rtt_avg);
+    buf[len++] = 'm';
+    buf[len++] = 's';
+    buf[len] = '\0';
+    update_status(buf, COL_READY);
+}
+
+static void add_to_average(uint16_t force) {
     if (strike_count < AVG_WINDOW_SIZE) {
         strike_count++;
+    } else {
+        strike_sum -= strike_history[strike_index];
+    }
+    
+    strike_history[strike_index] = force;
+    strike_sum += force;
+    
+    if (++strike_index == AVG_WINDOW_SIZE) {
+        strike_index = 0;
     }
     
     update_avg_display();
 }
 
+static void led_off(void) {
+    LED_PORT &= ~(1 << LED_PIN);
+}
+
+static void detect_task(void) {
+    uint8_t events = trace_strike_poll(&strike);
+    
+    if (events & DET_EVENT_ONSET) {
+        power_hit();
+        display_set_text(pad_field, hit_pad_name(strike.pad));
+        LED_PORT |= (1 << LED_PIN);
+        sched_start(led_off_task, LED_PULSE_MS);
+    }
+    
+    if (events & DET_EVENT_PEAK) {
+        add_to_average((uint16_t)strike.amplitude);
+    }
+}
+
+static void display_task(void) {
+    prof_t t = PROF_BEGIN();
+
+    display_service();
+    PROF_END(PROF_DISPLAY, t);
+}
+
+static void command_task(void) {
+    int cmd = uart_try_receive();
+    
+    if (trace_command(cmd) || prof_command(cmd) || stream_command(cmd))
+        return;
+    
+    if (cmd == ORIENT_CMD_ZERO) {
+        orient_zero_yaw(&strike.orient);
+        return;
+    }
+    
+    switch (calib_command(&cal, &imu, cmd, rest, noise)) {
+        case CALIB_RECALIBRATED:
+            strike_init(&strike, &role, &imu, &cal, rest, noise);
+            break;
+        case CALIB_SENSITIVITY:
+            detector_set_sensitivity(&strike.det, cal.sensitivity);
+            break;
+        default:
+            break;
+    }
+}
+
 int main(void)
 {
     uart_init();
+    power_init(POWER_KEEP_SPI);
     
     LED_DDR |= (1 << LED_PIN);
     PORTB &= ~(1 << LED_PIN);
@@ -117,67 +226,54 @@ int main(void)
     
     draw_static_info();
     
-    if (IMU_init(0x6B) < 0)
+    update_status("LINK SETUP", COL_ACCENT);
+    display_flush();
+    trace_init(&imu, hc05_link_setup(HC05_LINK_BAUD));
+    
+    /* the gyro is on for the pad zones */
+    if (imu_open(&imu, IMU_ADDR_HIGH) < 0 || imu_set_rate(&imu, role.odr, role.odr) < 0)
     {
         update_status("IMU NOT FOUND", COL_ERROR);
+        display_flush();
+        while (1) {
+            _delay_ms(1000);
+        }
+    }
+    
+    update_status("CALIBRATING", COL_ACCENT);
+    display_flush();
+    if (calib_boot(&cal, &imu, role.det.noise_mult, rest, noise) < 0)
+    {
+        update_status("CAL FAILED", COL_ERROR);
+        display_flush();
         while (1) {
             _delay_ms(1000);
         }
     }
+    strike_init(&strike, &role, &imu, &cal, rest, noise);
     
-    update_status("READY", COL_READY);
+    power_add_imu(&imu);
+    sched_init();
+    prof_init(role.pad);
+    detect_id = sched_add(detect_task, role.sample_period_ms);   // first task = highest priority
+    sched_add(stream_task, role.sample_period_ms);
+    sched_add(trace_task, TRACE_PERIOD_MS);
+    led_off_task = sched_add(led_off, 0);
+    sched_add(command_task, COMMAND_PERIOD_MS);
+    sched_add(display_task, DISPLAY_PERIOD_MS);
+    sched_add(power_task, POWER_POLL_MS);
+    sched_add(prof_task, PROF_TASK_MS);                          // lowest priority
+    power_standby_init(detect_id);
+    prof_set_detect_task(detect_id);
+    stream_init(&imu, role.pad, role.sample_period_ms, detect_id, 1);
     
-    float ay_buffer[BUFFER_SIZE] = {0};
-    uint8_t buf_index = 0;
-    uint8_t samples_filled = 0;
-    uint16_t samples_since_tap = MIN_SAMPLES_BETWEEN;
+    show_link_status();
     
-    uint8_t imu_buf[6];
-
     while (1)
     {
-        if (IMU_readAccBytes(imu_buf) == 0)
+        if (!sched_run())
         {
-            int16_t raw_y = (int16_t)((imu_buf[3] << 8) | imu_buf[2]);
-            float ay = raw_y / 4096.0f;
-
-            ay_buffer[buf_index] = ay;
-            buf_index = (buf_index + 1) % BUFFER_SIZE;
-            
-            if (samples_filled < BUFFER_SIZE)
-            {
-                samples_filled++;
-            }
-            
-            samples_since_tap++;
-
-            if (samples_filled >= BUFFER_SIZE && samples_since_tap >= MIN_SAMPLES_BETWEEN)
-            {
-                uint8_t prev_idx = (buf_index + BUFFER_SIZE - 2) % BUFFER_SIZE;
-                uint8_t curr_idx = (buf_index + BUFFER_SIZE - 1) % BUFFER_SIZE;
-                uint8_t next_idx = buf_index;
-                
-                float prev = ay_buffer[prev_idx];
-                float curr = ay_buffer[curr_idx];
-                float next = ay_buffer[next_idx];
-                
-                if (curr < PEAK_THRESHOLD && curr < prev && curr < next)
-                {
-                    float strike_force = -curr;  
-                    
-                    LED_PORT |= (1 << LED_PIN);
-                    uart_send('2', NULL);
-                    
-                    add_to_average(strike_force);
-                    
-                    _delay_ms(50);
-                    LED_PORT &= ~(1 << LED_PIN);
-                    
-                    samples_since_tap = 0;
-                }
-            }
+            sched_sleep();
         }
-        
-        _delay_ms(20); 
     }
 }
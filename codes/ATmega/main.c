@@ -4,6 +4,7 @@
 #include "uart.h"
 #include "i2c.h"
 #include "imu.h"
+#include "fmt.h"
 
 int main(void)
 {
@@ -23,7 +24,7 @@ int main(void)
     printf("IMU Ready! Reading acceleration...\r\n");
 
     uint8_t buf[6];
-    float ax, ay, az;
+    char ax[12], ay[12], az[12];
 
     while (1) {
 
@@ -38,11 +39,11 @@ int main(void)
             int16_t raw_z = (int16_t)((buf[5] << 8) | buf[4]);
 
 
-            ax = raw_x / 4096.0f;
-            ay = raw_y / 4096.0f;
-            az = raw_z / 4096.0f;
+            fmt_raw_g(ax, raw_x, 3);
+            fmt_raw_g(ay, raw_y, 3);
+            fmt_raw_g(az, raw_z, 3);
 
-            printf("ACC (g): X=%.3f  Y=%.3f  Z=%.3f\r\n", ax, ay, az);
+            printf("ACC (g): X=%s  Y=%s  Z=%s\r\n", ax, ay, az);
         }
         else {
             printf("I2C READ ERROR\r\n");
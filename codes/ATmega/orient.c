@@ -0,0 +1,126 @@
+#include "orient.h"
+#include "gravity.h"
+#include "imu.h"
+
+/* Gyro count x ms -> binary angle << 16 */
+#define ORIENT_GYRO_SCALE   ((int32_t)(IMU_GYRO_mdps_PER_LSB * 65536LL * 65536 / 360000000L))
+
+static uint16_t abs16(int16_t v)
+{
+    return (v < 0) ? (uint16_t)(-(int32_t)v) : (uint16_t)v;
+}
+
+int16_t orient_atan2(int16_t y, int16_t x)
+{
+    uint16_t ax = abs16(x), ay = abs16(y);
+    int32_t r, a;
+
+    if (ax == 0 && ay == 0)
+        return 0;
+
+    /* first octant ratio in Q15, then atan(r) ~ r*pi/4 + 0.273*r*(1 - r) */
+    if (ay <= ax)
+        r = ((uint32_t)ay << 15) / ax;
+    else
+        r = ((uint32_t)ax << 15) / ay;
+
+    a = ((r * 8192) >> 15) + ((((r * (32768 - r)) >> 15) * 2848) >> 15);
+
+    if (ay > ax)
+        a = 16384 - a;
+    if (x < 0)
+        a = 32768 - a;
+    if (y < 0)
+        a = -a;
+
+    return (int16_t)(uint16_t)a;
+}
+
+static int16_t acc_pitch(const orient_t *o, const int16_t acc[3])
+{
+    const orient_config_t *c = o->cfg;
+    int16_t along = c->long_sign > 0 ? acc[c->long_axis] : -acc[c->long_axis];
+    int16_t up = c->up_sign > 0 ? acc[c->up_axis] : -acc[c->up_axis];
+
+    return orient_atan2(along, up);
+}
+
+void orient_init(orient_t *o, const orient_config_t *cfg, const int16_t acc[3])
+{
+    o->cfg = cfg;
+    o->pitch_axis = 3 - cfg->long_axis - cfg->up_axis;
+
+    /* a turn about the third axis of a right-handed (long, up, third) raises the tip */
+    o->pitch_sign = ((cfg->up_axis + 3 - cfg->long_axis) % 3 == 1) ? 1 : -1;
+    o->pitch_sign *= cfg->long_sign * cfg->up_sign;
+
+    o->bias_acc[0] = 0;
+    o->bias_acc[1] = 0;
+    o->yaw = 0;
+    o->pitch = (uint32_t)(uint16_t)acc_pitch(o, acc) << 16;
+}
+
+void orient_zero_yaw(orient_t *o)
+{
+    o->yaw = 0;
+}
+
+void orient_update(orient_t *o, const int16_t acc[3], const int16_t gyro[3], uint16_t dt_ms)
+{
+    const orient_config_t *c = o->cfg;
+    int16_t rate[2];
+    uint16_t mag = gravity_magnitude(acc[0], acc[1], acc[2]);
+    uint8_t level = (mag > IMU_ACC_LSB_PER_G - ORIENT_STILL_G && mag < IMU_ACC_LSB_PER_G + ORIENT_STILL_G);
+
+    rate[0] = c->up_sign > 0 ? gyro[c->up_axis] : -gyro[c->up_axis];
+    rate[1] = o->pitch_sign > 0 ? gyro[o->pitch_axis] : -gyro[o->pitch_axis];
+
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        int16_t bias = (int16_t)(o->bias_acc[i] >> ORIENT_BIAS_SHIFT);
+        int16_t r = rate[i] - bias;
+
+        /* held still: whatever the gyro still reads is bias */
+        if (level && abs16(r) < ORIENT_STILL_RATE)
+            o->bias_acc[i] += r;
+
+        rate[i] = r;
+    }
+
+    /* binary angles wrap, so the sums are done unsigned */
+    o->yaw += (uint32_t)((int32_t)rate[0] * dt_ms * ORIENT_GYRO_SCALE);
+    o->pitch += (uint32_t)((int32_t)rate[1] * dt_ms * ORIENT_GYRO_SCALE);
+
+    if (level)
+    {
+        int32_t err = (int32_t)(((uint32_t)(uint16_t)acc_pitch(o, acc) << 16) - o->pitch);
+        o->pitch += (uint32_t)(err >> ORIENT_ACC_SHIFT);
+    }
+}
+
+int16_t orient_yaw(const orient_t *o)
+{
+    return (int16_t)(uint16_t)(o->yaw >> 16);
+}
+
+int16_t orient_pitch(const orient_t *o)
+{
+    return (int16_t)(uint16_t)(o->pitch >> 16);
+}
+
+char orient_pad(const orient_t *o, char fallback)
+{
+    int16_t yaw = orient_yaw(o);
+    int16_t pitch = orient_pitch(o);
+
+    for (uint8_t i = 0; i < o->cfg->n_zones; i++)
+    {
+        const orient_zone_t *z = &o->cfg->zones[i];
+
+        if ((uint16_t)(yaw - z->yaw_min) < (uint16_t)(z->yaw_max - z->yaw_min) &&
+            pitch >= z->pitch_min && pitch < z->pitch_max)
+            return z->pad;
+    }
+
+    return fallback;
+}
@@ -0,0 +1,81 @@
+#ifndef ORIENT_H
+#define ORIENT_H
+
+#include <stdint.h>
+
+/*
+ * Stick orientation, for choosing one of several virtual pads per stick.
+ *
+ * A fixed-point complementary filter: yaw and pitch are integrated from the
+ * gyro every sample, and pitch is pulled toward the accelerometer's tilt
+ * whenever the stick is close to 1 g, i.e. not swinging. Yaw has no
+ * absolute reference, so it is zeroed while pointing at the home pad (at
+ * boot and with ORIENT_CMD_ZERO) and the gyro bias is learned whenever the
+ * stick is held still.
+ *
+ * The sensor is assumed mounted with long_axis along the stick and up_axis
+ * vertical when the stick is level. Yaw turns about up_axis, pitch about the
+ * third axis, and roll is ignored, which is close enough to pick a zone.
+ *
+ * Angles are binary: a full turn is 65536, so an int16_t wraps at +/-180
+ * degrees. Per sample this is one 32/16-bit divide and a few multiplies,
+ * well under 2000 cycles on a 16 MHz AVR. The gyro and accelerometer come
+ * from the same 12-byte burst the strike pipeline reads anyway, so picking
+ * the pad at onset costs no latency.
+ *
+ * Plain C, no AVR headers, so it can be built and replayed on a host.
+ */
+
+#define ORIENT_DEG(d)       ((int16_t)((d) * 65536L / 360))
+
+#define ORIENT_MAX_ZONES    4
+#define ORIENT_ACC_SHIFT    4       // pitch pull toward the accelerometer, 1/16 per sample
+#define ORIENT_BIAS_SHIFT   6       // gyro bias EWMA while still, alpha = 1/64
+#define ORIENT_STILL_G      820     // raw counts (0.2 g) from 1 g that still counts as not swinging
+#define ORIENT_STILL_RATE   143     // raw gyro counts (10 dps) below which the stick is held still
+
+#define ORIENT_CMD_ZERO     'Z'     // point at the home pad and send this to re-zero yaw
+
+/* yaw_min <= yaw < yaw_max (may wrap past 180), pitch_min <= pitch < pitch_max */
+typedef struct {
+    int16_t yaw_min, yaw_max;       // counter-clockwise seen from above is positive
+    int16_t pitch_min, pitch_max;   // tip up is positive
+    char    pad;                    // HIT_PAD_* sent for a strike in this zone
+} orient_zone_t;
+
+typedef struct {
+    uint8_t long_axis;              // 0 x, 1 y, 2 z
+    int8_t  long_sign;              // +1 if the tip points along +long_axis
+    uint8_t up_axis;
+    int8_t  up_sign;
+    uint8_t n_zones;
+    orient_zone_t zones[ORIENT_MAX_ZONES];  // first match wins
+} orient_config_t;
+
+typedef struct {
+    const orient_config_t *cfg;
+    uint32_t yaw;                   // binary angle << 16
+    uint32_t pitch;
+    int32_t  bias_acc[2];           // yaw, pitch gyro bias << ORIENT_BIAS_SHIFT
+    uint8_t  pitch_axis;
+    int8_t   pitch_sign;
+} orient_t;
+
+/* acc: a calibrated sample at rest, seeds the pitch; yaw starts at 0 */
+void orient_init(orient_t *o, const orient_config_t *cfg, const int16_t acc[3]);
+
+/* Feed one calibrated accelerometer sample and the gyro read with it */
+void orient_update(orient_t *o, const int16_t acc[3], const int16_t gyro[3], uint16_t dt_ms);
+
+void orient_zero_yaw(orient_t *o);
+
+int16_t orient_yaw(const orient_t *o);
+int16_t orient_pitch(const orient_t *o);
+
+/* Pad of the first zone the stick points into, fallback if none */
+char orient_pad(const orient_t *o, char fallback);
+
+/* atan2(y, x) as a binary angle, within about 0.3 degrees */
+int16_t orient_atan2(int16_t y, int16_t x);
+
+#endif /* ORIENT_H */
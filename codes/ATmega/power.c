@@ -0,0 +1,172 @@
+#include <avr/io.h>
+#include <avr/sleep.h>
+#include "power.h"
+#include "sched.h"
+#include "trace.h"
+#include "stream.h"
+
+typedef struct {
+    imu_t *imu;
+    uint8_t acc_odr;            // rates to restore on wake-up
+    uint8_t gyro_odr;
+} power_imu_t;
+
+static power_imu_t imus[POWER_MAX_IMUS];
+static uint8_t imu_count = 0;
+static uint8_t detect_id = 0xFF;
+static uint8_t standby = 0;
+static uint8_t waking = 0;              // waiting for the first hit after a wake-up
+static uint16_t last_hit;
+static uint16_t woke_at;
+static uint16_t last_poll;
+static uint16_t ms_part[2];             // active, standby: ms not yet in seconds
+static uint32_t seconds[2];
+static power_stats_t stats;
+
+void power_init(uint8_t keep)
+{
+    /* the ADC has to be off before its clock is gated */
+    ADCSRA = 0;
+
+    PRR0 = (1 << PRADC) | (1 << PRTIM2) | (1 << PRUSART1);
+    if (!(keep & POWER_KEEP_SPI))
+        PRR0 |= (1 << PRSPI0);
+    PRR1 = (1 << PRTWI1) | (1 << PRPTC) | (1 << PRTIM4) | (1 << PRSPI1) | (1 << PRTIM3);
+
+    set_sleep_mode(SLEEP_MODE_IDLE);
+}
+
+void power_add_imu(imu_t *imu)
+{
+    if (imu_count < POWER_MAX_IMUS)
+        imus[imu_count++].imu = imu;
+}
+
+void power_standby_init(uint8_t detect_task)
+{
+    detect_id = detect_task;
+    last_hit = sched_now();
+    last_poll = last_hit;
+}
+
+void power_hit(void)
+{
+    uint16_t now = sched_now();
+
+    last_hit = now;
+    if (waking)
+    {
+        waking = 0;
+        stats.wake_latency_ms = now - woke_at;
+        if (stats.wake_latency_ms > stats.wake_latency_max_ms)
+            stats.wake_latency_max_ms = stats.wake_latency_ms;
+    }
+}
+
+static void enter_standby(void)
+{
+    for (uint8_t i = 0; i < imu_count; i++)
+    {
+        power_imu_t *p = &imus[i];
+
+        p->acc_odr = p->imu->acc_odr;
+        p->gyro_odr = p->imu->gyro_odr;
+        imu_set_rate(p->imu, POWER_STANDBY_ODR, IMU_ODR_OFF);
+        imu_wakeup_arm(p->imu, POWER_WAKE_THS);
+        imu_wakeup_pending(p->imu);     // drop a stale latch
+    }
+
+    sched_stop(detect_id);
+    standby = 1;
+    waking = 0;
+    if (stats.standby_entries < 0xFFFF)
+        stats.standby_entries++;
+}
+
+static void leave_standby(uint16_t now)
+{
+    for (uint8_t i = 0; i < imu_count; i++)
+    {
+        power_imu_t *p = &imus[i];
+
+        imu_wakeup_arm(p->imu, 0);
+        imu_set_rate(p->imu, p->acc_odr, p->gyro_odr);
+    }
+
+    if (!stream_active())
+        sched_start(detect_id, 0);
+    standby = 0;
+    waking = 1;
+    woke_at = now;
+    last_hit = now;
+}
+
+void power_wake(void)
+{
+    if (standby)
+        leave_standby(sched_now());
+}
+
+static uint8_t motion(void)
+{
+    uint8_t seen = 0;
+
+    /* read every sensor so each latch is cleared */
+    for (uint8_t i = 0; i < imu_count; i++)
+        seen |= imu_wakeup_pending(imus[i].imu);
+
+    return seen;
+}
+
+static void account(uint16_t now)
+{
+    uint8_t s = standby;
+
+    ms_part[s] += (uint16_t)(now - last_poll);
+    last_poll = now;
+    while (ms_part[s] >= 1000)
+    {
+        ms_part[s] -= 1000;
+        seconds[s]++;
+    }
+}
+
+void power_task(void)
+{
+    uint16_t now = sched_now();
+
+    account(now);
+
+    if (detect_id == 0xFF)
+        return;
+
+    if (waking && (uint16_t)(now - woke_at) > POWER_WAKE_WINDOW_MS)
+        waking = 0;
+
+    if (standby)
+    {
+        if (motion() || stream_active())
+            leave_standby(now);
+    }
+    else if ((uint16_t)(now - last_hit) >= POWER_STANDBY_MS && !trace_active() && !stream_active())
+    {
+        enter_standby();
+    }
+}
+
+void power_get_stats(power_stats_t *st)
+{
+    uint32_t total = seconds[0] + seconds[1];
+    uint32_t avg_uA = POWER_ACTIVE_uA;
+
+    *st = stats;
+    st->standby_permille = 0;
+    if (total)
+    {
+        st->standby_permille = (uint16_t)(seconds[1] * 1000 / total);
+        avg_uA -= (POWER_ACTIVE_uA - POWER_STANDBY_uA) * st->standby_permille / 1000;
+    }
+
+    /* mAh * 60000 / uA = minutes */
+    st->battery_min = (uint16_t)((uint32_t)POWER_BATTERY_mAh * 60000UL / avg_uA);
+}
@@ -0,0 +1,74 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+#include "imu.h"
+
+/*
+ * Power management for the battery nodes.
+ *
+ * power_init() gates the clocks of every peripheral a node never uses and
+ * selects idle sleep, which the main loop enters through sched_sleep()
+ * whenever no task is due. The 1 ms tick, UART and TWI still wake it.
+ *
+ * After POWER_STANDBY_MS without a hit the node goes to standby: the
+ * detection task stops, the IMUs drop to POWER_STANDBY_ODR with the gyro
+ * off and their wake-up (motion) detector armed, and only the latched
+ * wake-up flag is read every POWER_POLL_MS. The first motion over
+ * POWER_WAKE_THS restores the previous rates and restarts detection. A
+ * strike that wakes the node can be late by up to one standby sample plus
+ * one poll, so the time from wake-up to the first hit within
+ * POWER_WAKE_WINDOW_MS is recorded as the wake-to-detect latency. Yaw is
+ * not tracked while the gyro is off.
+ *
+ * Battery life is estimated from the time spent in each state and the
+ * per-state currents below, which should be measured for each build. The
+ * HC-05 stays connected in standby and draws most of the current.
+ */
+
+#define POWER_STANDBY_MS        20000   // no hits this long -> standby
+#define POWER_POLL_MS           40      // accounting, and wake-up polling in standby
+#define POWER_STANDBY_ODR       IMU_ODR_26HZ
+#define POWER_WAKE_THS          2       // 0.25 g, see imu_wakeup_arm()
+#define POWER_WAKE_WINDOW_MS    1000    // a hit later than this did not cause the wake-up
+#define POWER_MAX_IMUS          2
+
+#define POWER_BATTERY_mAh       500
+#define POWER_ACTIVE_uA         30000UL // HC-05 connected, CPU idling at 16 MHz, IMU at 208 Hz
+#define POWER_STANDBY_uA        24000UL // HC-05 connected, CPU mostly asleep, IMU at 26 Hz
+
+/* power_init() flags for peripherals a node does use beyond the defaults */
+#define POWER_KEEP_SPI          0x01    // LCD
+
+typedef struct {
+    uint16_t standby_permille;      // share of the time since boot spent in standby
+    uint16_t standby_entries;
+    uint16_t wake_latency_ms;       // wake-up to first hit, last time one was seen
+    uint16_t wake_latency_max_ms;
+    uint16_t battery_min;           // estimated run time on a full charge
+} power_stats_t;
+
+/* Keeps TWI0, USART0 and Timers 0/1 running, plus whatever keep asks for */
+void power_init(uint8_t keep);
+
+/* Register a sensor that is slowed down and watched for motion in standby */
+void power_add_imu(imu_t *imu);
+
+/* Enable standby; detect_task is the sched id of the detection task */
+void power_standby_init(uint8_t detect_task);
+
+/* Call on every strike onset */
+void power_hit(void);
+
+/*
+ * Leave standby now rather than on the next poll, before a caller saves
+ * the IMU rates to change them, so it does not save the standby ones
+ */
+void power_wake(void);
+
+/* Periodic task, POWER_POLL_MS */
+void power_task(void);
+
+void power_get_stats(power_stats_t *st);
+
+#endif /* POWER_H */
@@ -0,0 +1,147 @@
+#include <avr/io.h>
+#include "prof.h"
+#include "uart.h"
+#include "sched.h"
+#include "power.h"
+
+#define PROF_TICKS_PER_US   (F_CPU / 8 / 1000000UL)
+
+typedef struct {
+    uint16_t min;
+    uint16_t max;
+    uint32_t sum;
+    uint16_t count;
+} prof_probe_t;
+
+static prof_probe_t probes[PROF_PROBES];
+static uint16_t counters[PROF_COUNTERS];
+static char node_id = '?';
+static uint8_t pending = 0;
+static uint16_t next_report = 0;
+static uint16_t link_rtt_ms = 0;
+static uint8_t link_lost = 0;
+static uint8_t detect_id = 0xFF;
+
+void prof_init(char node)
+{
+    node_id = node;
+
+    /* normal mode, F_CPU / 8, no interrupts */
+    TCCR1A = 0;
+    TCCR1B = (1 << CS11);
+
+    next_report = sched_now() + PROF_REPORT_MS;
+}
+
+void prof_end(uint8_t probe, prof_t start)
+{
+    uint16_t dt = (uint16_t)(TCNT1 - start);
+    prof_probe_t *p = &probes[probe];
+
+    if (p->count == 0 || dt < p->min)
+        p->min = dt;
+    if (dt > p->max)
+        p->max = dt;
+    p->sum += dt;
+    if (p->count < 0xFFFF)
+        p->count++;
+}
+
+void prof_set_link(uint16_t rtt_avg_ms, uint8_t lost)
+{
+    link_rtt_ms = rtt_avg_ms;
+    link_lost = lost;
+}
+
+void prof_set_detect_task(uint8_t detect_task)
+{
+    detect_id = detect_task;
+}
+
+void prof_count(uint8_t counter)
+{
+    if (counters[counter] < 0xFFFF)
+        counters[counter]++;
+}
+
+uint8_t prof_command(int cmd)
+{
+    if (cmd != PROF_CMD_STATS)
+        return 0;
+
+    pending = 1;
+    return 1;
+}
+
+static uint8_t *put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static void send_frame(void)
+{
+    uint8_t frame[PROF_FRAME_LEN];
+    uint8_t *p = &frame[2];
+    uart_stats_t us;
+    power_stats_t ps;
+    uint8_t sum = 0;
+
+    uart_get_stats(&us);
+    power_get_stats(&ps);
+
+    frame[0] = PROF_SYNC;
+    frame[1] = (uint8_t)node_id;
+    for (uint8_t i = 0; i < PROF_PROBES; i++)
+    {
+        const prof_probe_t *q = &probes[i];
+        uint16_t avg = q->count ? q->sum / q->count : 0;
+
+        p = put16(p, q->min / PROF_TICKS_PER_US);
+        p = put16(p, avg / PROF_TICKS_PER_US);
+        p = put16(p, q->max / PROF_TICKS_PER_US);
+        p = put16(p, q->count);
+    }
+    p = put16(p, counters[PROF_CNT_I2C_ERROR]);
+    p = put16(p, sched_overruns(detect_id));
+    p = put16(p, us.tx_overflow);
+    p = put16(p, us.rx_overflow);
+    p = put16(p, us.rx_frame_errors);
+    p = put16(p, ps.standby_permille);
+    p = put16(p, ps.wake_latency_ms);
+    p = put16(p, ps.wake_latency_max_ms);
+    p = put16(p, ps.battery_min);
+    p = put16(p, link_rtt_ms);
+    p = put16(p, link_lost);
+
+    for (uint8_t i = 1; i < PROF_FRAME_LEN - 1; i++)
+        sum += frame[i];
+    frame[PROF_FRAME_LEN - 1] = sum;
+
+    for (uint8_t i = 0; i < PROF_FRAME_LEN; i++)
+        uart_try_send(frame[i]);
+
+    for (uint8_t i = 0; i < PROF_PROBES; i++)
+    {
+        probes[i].sum = 0;
+        probes[i].max = 0;
+        probes[i].count = 0;
+    }
+}
+
+void prof_task(void)
+{
+    if ((int16_t)(sched_now() - next_report) >= 0)
+    {
+        next_report += PROF_REPORT_MS;
+        pending = 1;
+    }
+
+    /* never block the detection loop: wait for room instead */
+    if (pending && uart_tx_free() >= PROF_FRAME_LEN)
+    {
+        pending = 0;
+        send_frame();
+    }
+}
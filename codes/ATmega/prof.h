@@ -0,0 +1,91 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+
+/*
+ * On-node timing probes and health counters.
+ *
+ * Timer1 free-runs at F_CPU / 8, so a probe is two reads of TCNT1 and
+ * measures up to ~32 ms in 0.5 us ticks. Each probe keeps min, sum, max
+ * and count since the last report. The node sends a stats frame when the
+ * hub asks with PROF_CMD_STATS, and on its own every PROF_REPORT_MS:
+ *
+ *   byte  0      PROF_SYNC
+ *   byte  1      node pad character ('1', '2', '3')
+ *   bytes 2-33   per probe, in prof_probe_id order:
+ *                  min us, avg us, max us, count   uint16 LE each
+ *   bytes 34-43  I2C errors, missed samples, UART tx overflows,
+ *                UART rx overflows, UART frame errors   uint16 LE each
+ *   bytes 44-51  standby share (permille), last and worst wake-to-detect
+ *                latency (ms), estimated battery life (minutes), see power.h
+ *   bytes 52-55  boot link self-test (hc05.h): average round trip (ms),
+ *                pings lost
+ *   byte  56     sum of bytes 1-55, mod 256
+ *
+ * Probes reset after every frame, so each covers one report window; a
+ * probe with count 0 did not run in it. Counters run from boot and
+ * saturate, so the hub sees new errors as a difference between frames.
+ *
+ * The PROF_ macros compile to nothing off the AVR (host replay) or with
+ * PROF_DISABLE defined (cycle benchmarks).
+ */
+
+#define PROF_SYNC           0xE4
+#define PROF_FRAME_LEN      57
+#define PROF_CMD_STATS      'S'
+#define PROF_REPORT_MS      10000
+#define PROF_TASK_MS        100     // retry period while a frame waits for UART room
+
+typedef enum {
+    PROF_I2C,           // accelerometer burst read
+    PROF_DETECT,        // gravity tracking and onset detection
+    PROF_DISPLAY,       // one display_service() step
+    PROF_UART,          // queueing hit messages
+    PROF_PROBES
+} prof_probe_id;
+
+typedef enum {
+    PROF_CNT_I2C_ERROR,
+    PROF_COUNTERS
+} prof_counter_id;
+
+typedef uint16_t prof_t;
+
+#if defined(__AVR__) && !defined(PROF_DISABLE)
+
+#include <avr/io.h>
+
+#define PROF_BEGIN()            ((prof_t)TCNT1)
+#define PROF_END(probe, start)  prof_end((probe), (start))
+#define PROF_COUNT(counter)     prof_count(counter)
+
+#else
+
+#define PROF_BEGIN()            ((prof_t)0)
+#define PROF_END(probe, start)  ((void)(start))
+#define PROF_COUNT(counter)     ((void)0)
+
+#endif
+
+/* Start Timer1; node is the pad character put in every frame */
+void prof_init(char node);
+
+void prof_end(uint8_t probe, prof_t start);
+
+/* Result of the boot link self-test, sent in every frame */
+void prof_set_link(uint16_t rtt_avg_ms, uint8_t lost);
+
+/* The sched id of the detection task, whose overruns are the missed samples */
+void prof_set_detect_task(uint8_t detect_task);
+
+/* Saturating increment */
+void prof_count(uint8_t counter);
+
+/* Handle a received command byte. Returns 1 if it was a stats request. */
+uint8_t prof_command(int cmd);
+
+/* Periodic task, PROF_TASK_MS; sends requested and scheduled frames */
+void prof_task(void);
+
+#endif /* PROF_H */
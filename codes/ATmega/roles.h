@@ -0,0 +1,155 @@
+#ifndef ROLES_H
+#define ROLES_H
+
+#include <stddef.h>
+#include "strike.h"
+#include "orient.h"
+#include "hit.h"
+#include "imu.h"
+
+/*
+ * Detection settings for each node role, in one place so the host replay
+ * and tuning tools run exactly what the firmware runs.
+ *
+ * Building with -DROLES_TUNED pulls overrides for the values below from
+ * roles_tuned.h, as generated by codes/Host/tune.
+ */
+
+#ifdef ROLES_TUNED
+#include "roles_tuned.h"
+#endif
+
+/* Right hand stick, snare: strikes swing down along -Y */
+#ifndef RIGHT_HAND_TRIGGER_FLOOR
+#define RIGHT_HAND_TRIGGER_FLOOR    IMU_G_TO_RAW(1.5f)  // Never trigger below 1.5g from rest
+#endif
+#ifndef RIGHT_HAND_NOISE_MULT
+#define RIGHT_HAND_NOISE_MULT       24                  // Default trigger at 6x the resting noise
+#endif
+#ifndef RIGHT_HAND_HOLDOFF
+#define RIGHT_HAND_HOLDOFF          12                  // ~60ms gap between taps
+#endif
+#ifndef RIGHT_HAND_ONSET_SLOPE
+#define RIGHT_HAND_ONSET_SLOPE      IMU_G_TO_RAW(0.5f)  // Rise per sample that counts as an onset
+#endif
+#define RIGHT_HAND_SAMPLE_PERIOD_MS 5
+#define RIGHT_HAND_ODR              IMU_ODR_208HZ       // 4.8 ms, a new sample for every read
+
+/* Left hand stick, hi-hat: same motion as the right hand */
+#ifndef LEFT_HAND_TRIGGER_FLOOR
+#define LEFT_HAND_TRIGGER_FLOOR     IMU_G_TO_RAW(1.5f)
+#endif
+#ifndef LEFT_HAND_NOISE_MULT
+#define LEFT_HAND_NOISE_MULT        24
+#endif
+#ifndef LEFT_HAND_HOLDOFF
+#define LEFT_HAND_HOLDOFF           12
+#endif
+#ifndef LEFT_HAND_ONSET_SLOPE
+#define LEFT_HAND_ONSET_SLOPE       IMU_G_TO_RAW(0.5f)
+#endif
+#define LEFT_HAND_SAMPLE_PERIOD_MS  5
+#define LEFT_HAND_ODR               IMU_ODR_208HZ
+
+/* Kick pedal: taps move along -Z, sampled fast for short pedal strokes */
+#ifndef KICK_PEDAL_TRIGGER_FLOOR
+#define KICK_PEDAL_TRIGGER_FLOOR    IMU_G_TO_RAW(0.75f) // Never trigger below 0.75g from rest
+#endif
+#ifndef KICK_PEDAL_NOISE_MULT
+#define KICK_PEDAL_NOISE_MULT       24
+#endif
+#ifndef KICK_PEDAL_HOLDOFF
+#define KICK_PEDAL_HOLDOFF          20                  // ~100ms gap between taps
+#endif
+#ifndef KICK_PEDAL_ONSET_SLOPE
+#define KICK_PEDAL_ONSET_SLOPE      IMU_G_TO_RAW(0.3f)
+#endif
+#define KICK_PEDAL_SAMPLE_PERIOD_MS 5
+#define KICK_PEDAL_ODR              IMU_ODR_208HZ       // 4.8 ms, a new sample for every read
+
+/* Hi-hat foot on the kick node's second sensor (feet.c): same motion as the kick */
+#ifndef HIHAT_FOOT_TRIGGER_FLOOR
+#define HIHAT_FOOT_TRIGGER_FLOOR    IMU_G_TO_RAW(0.75f)
+#endif
+#ifndef HIHAT_FOOT_NOISE_MULT
+#define HIHAT_FOOT_NOISE_MULT       24
+#endif
+#ifndef HIHAT_FOOT_HOLDOFF
+#define HIHAT_FOOT_HOLDOFF          20
+#endif
+#ifndef HIHAT_FOOT_ONSET_SLOPE
+#define HIHAT_FOOT_ONSET_SLOPE      IMU_G_TO_RAW(0.3f)
+#endif
+#define HIHAT_FOOT_SAMPLE_PERIOD_MS KICK_PEDAL_SAMPLE_PERIOD_MS  // both sampled by one task
+#define HIHAT_FOOT_ODR              KICK_PEDAL_ODR
+
+/* Kick node with display (final.c): strikes move along +Z */
+#ifndef FINAL_KICK_TRIGGER_FLOOR
+#define FINAL_KICK_TRIGGER_FLOOR    IMU_G_TO_RAW(0.8f)  // Never trigger below 0.8g from rest
+#endif
+#ifndef FINAL_KICK_NOISE_MULT
+#define FINAL_KICK_NOISE_MULT       24
+#endif
+#ifndef FINAL_KICK_HOLDOFF
+#define FINAL_KICK_HOLDOFF          12
+#endif
+#ifndef FINAL_KICK_ONSET_SLOPE
+#define FINAL_KICK_ONSET_SLOPE      IMU_G_TO_RAW(0.5f)
+#endif
+#define FINAL_KICK_SAMPLE_PERIOD_MS 5
+#define FINAL_KICK_ODR              IMU_ODR_208HZ
+
+/*
+ * Virtual pads of the sticks, for a sensor with X along the stick toward
+ * the tip and Y up. Yaw 0 is wherever the stick pointed at boot or at the
+ * last ORIENT_CMD_ZERO, which should be the stick's own pad.
+ */
+#define STICK_MOUNT         .long_axis = 0, .long_sign = 1, .up_axis = 1, .up_sign = 1
+
+/* Right hand: crossing over to the left plays the hi-hat */
+#define RIGHT_HAND_ZONES {                                                  \
+    STICK_MOUNT,                                                            \
+    .n_zones = 1,                                                           \
+    .zones = {                                                              \
+        { ORIENT_DEG(25), ORIENT_DEG(120), ORIENT_DEG(-90), ORIENT_DEG(90), HIT_PAD_HIHAT }, \
+    },                                                                      \
+}
+
+/* Left hand: reaching over to the right plays the snare */
+#define LEFT_HAND_ZONES {                                                   \
+    STICK_MOUNT,                                                            \
+    .n_zones = 1,                                                           \
+    .zones = {                                                              \
+        { ORIENT_DEG(-120), ORIENT_DEG(-25), ORIENT_DEG(-90), ORIENT_DEG(90), HIT_PAD_SNARE }, \
+    },                                                                      \
+}
+
+#define ROLE_INIT_ORIENT(PREFIX, PAD, AXIS, SWING, ORIENT) { \
+    .pad = PAD,                                             \
+    .axis = AXIS,                                           \
+    .swing = SWING,                                         \
+    .sample_period_ms = PREFIX##_SAMPLE_PERIOD_MS,          \
+    .odr = PREFIX##_ODR,                                    \
+    .det = {                                                \
+        .polarity = 1,                                      \
+        .noise_mult = PREFIX##_NOISE_MULT,                  \
+        .trigger_floor = PREFIX##_TRIGGER_FLOOR,            \
+        .holdoff = PREFIX##_HOLDOFF,                        \
+        .onset_slope = PREFIX##_ONSET_SLOPE,                \
+    },                                                      \
+    .orient = ORIENT,                                       \
+}
+
+#define ROLE_INIT(PREFIX, PAD, AXIS, SWING)     ROLE_INIT_ORIENT(PREFIX, PAD, AXIS, SWING, NULL)
+
+#define ROLE_RIGHT_HAND     ROLE_INIT(RIGHT_HAND, HIT_PAD_SNARE, 1, -1)
+#define ROLE_LEFT_HAND      ROLE_INIT(LEFT_HAND, HIT_PAD_HIHAT, 1, -1)
+#define ROLE_KICK_PEDAL     ROLE_INIT(KICK_PEDAL, HIT_PAD_KICK, 2, -1)
+#define ROLE_FINAL_KICK     ROLE_INIT(FINAL_KICK, HIT_PAD_KICK, 2, 1)
+#define ROLE_HIHAT_FOOT     ROLE_INIT(HIHAT_FOOT, HIT_PAD_HIHAT, 2, -1)
+
+/* The stick roles with virtual pads; zones points at a *_HAND_ZONES object */
+#define ROLE_RIGHT_HAND_ZONED(zones)    ROLE_INIT_ORIENT(RIGHT_HAND, HIT_PAD_SNARE, 1, -1, zones)
+#define ROLE_LEFT_HAND_ZONED(zones)     ROLE_INIT_ORIENT(LEFT_HAND, HIT_PAD_HIHAT, 1, -1, zones)
+
+#endif /* ROLES_H */
@@ -0,0 +1,150 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include <util/atomic.h>
+#include "sched.h"
+
+typedef struct {
+    sched_task_fn fn;
+    uint16_t period;        // ms, 0 for one-shot
+    uint16_t due;           // tick of the next run
+    uint8_t  armed;
+    uint16_t overruns;
+} sched_task_t;
+
+static sched_task_t tasks[SCHED_MAX_TASKS];
+static uint8_t task_count = 0;
+static volatile uint16_t ticks = 0;
+static uint16_t last_run = 0;       // tick sched_run() last looked at
+
+ISR(TIMER0_COMPA_vect)
+{
+    ticks++;
+}
+
+void sched_init(void)
+{
+    /* CTC, 16 MHz / 64 / 250 = 1 kHz */
+    TCCR0A = (1 << WGM01);
+    OCR0A = 249;
+    TCCR0B = (1 << CS01) | (1 << CS00);
+    TIMSK0 |= (1 << OCIE0A);
+    sei();
+}
+
+uint16_t sched_now(void)
+{
+    uint16_t t;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        t = ticks;
+    }
+    return t;
+}
+
+uint16_t sched_now_fine(uint8_t *sub)
+{
+    uint16_t t;
+    uint8_t count;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        t = ticks;
+        count = TCNT0;
+        /* compare match not yet serviced: the counter already wrapped */
+        if (TIFR0 & (1 << OCF0A))
+        {
+            t++;
+            count = TCNT0;
+        }
+    }
+    *sub = count;
+    return t;
+}
+
+uint8_t sched_add(sched_task_fn fn, uint16_t period_ms)
+{
+    sched_task_t *t;
+
+    if (task_count >= SCHED_MAX_TASKS)
+        return 0xFF;
+
+    t = &tasks[task_count];
+    t->fn = fn;
+    t->period = period_ms;
+    t->due = sched_now() + period_ms;
+    t->armed = (period_ms != 0);
+    t->overruns = 0;
+
+    return task_count++;
+}
+
+void sched_start(uint8_t id, uint16_t delay_ms)
+{
+    if (id >= task_count)
+        return;
+
+    tasks[id].due = sched_now() + delay_ms;
+    tasks[id].armed = 1;
+}
+
+void sched_stop(uint8_t id)
+{
+    if (id < task_count)
+        tasks[id].armed = 0;
+}
+
+uint16_t sched_overruns(uint8_t id)
+{
+    return id < task_count ? tasks[id].overruns : 0;
+}
+
+uint8_t sched_run(void)
+{
+    uint16_t now = sched_now();
+
+    last_run = now;
+
+    for (uint8_t i = 0; i < task_count; i++)
+    {
+        sched_task_t *t = &tasks[i];
+
+        if (!t->armed || (int16_t)(now - t->due) < 0)
+            continue;
+
+        if (t->period)
+        {
+            t->due += t->period;
+            /* fell more than a period behind: skip ahead rather than burst */
+            if ((int16_t)(now - t->due) >= 0)
+            {
+                t->due = now + t->period;
+                if (t->overruns < 0xFFFF)
+                    t->overruns++;
+            }
+        }
+        else
+        {
+            t->armed = 0;
+        }
+
+        t->fn();
+        return 1;
+    }
+
+    return 0;
+}
+
+void sched_sleep(void)
+{
+    cli();
+    if (ticks == last_run)
+    {
+        sleep_enable();
+        sei();              // interrupts resume only once sleep_cpu() runs, none is lost
+        sleep_cpu();
+        sleep_disable();
+    }
+    sei();
+}
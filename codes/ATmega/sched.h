@@ -0,0 +1,55 @@
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdint.h>
+
+/*
+ * Tick-based cooperative scheduler for the nodes.
+ *
+ * Timer0 provides a 1 ms tick. Tasks are plain functions that run to
+ * completion and must keep each call short; long work (LCD redraws) is
+ * split across calls. Priority is the order tasks were added in, so the
+ * detection task is added first and every dispatch checks it before any
+ * LED, LCD or telemetry work.
+ */
+
+#define SCHED_MAX_TASKS     8
+
+typedef void (*sched_task_fn)(void);
+
+void sched_init(void);
+
+/* Milliseconds since sched_init(), wraps every ~65 s */
+uint16_t sched_now(void);
+
+/* sched_now() plus the position within the current tick, 0..249 in 4 us steps */
+uint16_t sched_now_fine(uint8_t *sub);
+
+/*
+ * Register a task and return its id. period_ms > 0 makes it periodic and
+ * starts it; 0 makes it one-shot, started later with sched_start().
+ */
+uint8_t sched_add(sched_task_fn fn, uint16_t period_ms);
+
+/* (Re)arm a task to run delay_ms from now */
+void sched_start(uint8_t id, uint16_t delay_ms);
+
+void sched_stop(uint8_t id);
+
+/*
+ * Times the task fell a whole period behind and skipped a run, since
+ * boot. For the detection task every one is a missed sample.
+ */
+uint16_t sched_overruns(uint8_t id);
+
+/* Run the highest priority task that is due. Returns 1 if one ran. */
+uint8_t sched_run(void);
+
+/*
+ * Call when sched_run() returned 0: sleeps in the mode set with
+ * set_sleep_mode() until the next interrupt, unless a tick arrived since
+ * sched_run() looked, so a task that just fell due is not delayed.
+ */
+void sched_sleep(void);
+
+#endif /* SCHED_H */
@@ -0,0 +1,136 @@
+#include "stream.h"
+#include "imu.h"
+#include "uart.h"
+#include "sched.h"
+
+static const imu_t *dev;
+static char node_pad;
+static uint8_t period;
+static uint8_t detect_id;
+static uint8_t with_gyro;
+static uint8_t active = 0;
+static uint8_t seq = 0;
+static uint8_t since_key = 0;
+static int16_t sent[6];                 // values the hub has reconstructed
+
+void stream_init(const imu_t *imu, char pad, uint8_t period_ms, uint8_t detect_task, uint8_t gyro)
+{
+    dev = imu;
+    node_pad = pad;
+    period = period_ms;
+    detect_id = detect_task;
+    with_gyro = gyro;
+}
+
+uint8_t stream_command(int cmd)
+{
+    switch (cmd)
+    {
+        case STREAM_CMD_START:
+            if (!active)
+            {
+                active = 1;
+                since_key = STREAM_KEY_EVERY;
+                sched_stop(detect_id);
+            }
+            return 1;
+        case STREAM_CMD_STOP:
+            if (active)
+            {
+                active = 0;
+                sched_start(detect_id, 0);
+            }
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+uint8_t stream_active(void)
+{
+    return active;
+}
+
+static void put16(uint8_t *p, int16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)((uint16_t)v >> 8);
+}
+
+/* Steps for every axis, 0 if one does not fit in an int8 */
+static uint8_t deltas(const int16_t v[6], uint8_t n, int8_t step[6])
+{
+    for (uint8_t i = 0; i < n; i++)
+    {
+        int32_t d = (int32_t)v[i] - sent[i];
+
+        /* round to the nearest step */
+        d = (d + (1 << (STREAM_DELTA_SHIFT - 1))) >> STREAM_DELTA_SHIFT;
+        if (d < -128 || d > 127)
+            return 0;
+        step[i] = (int8_t)d;
+    }
+    return 1;
+}
+
+void stream_task(void)
+{
+    uint8_t frame[STREAM_FRAME_MAX];
+    int16_t v[6];
+    int8_t step[6];
+    uint8_t n = with_gyro ? 6 : 3;
+    uint8_t len, sum = 0;
+    uint16_t ms;
+    int err;
+
+    if (!active)
+        return;
+
+    ms = sched_now();
+    err = with_gyro ? imu_read_acc_gyro(dev, &v[0], &v[3]) : imu_read_acc(dev, &v[0]);
+    if (err != 0)
+        return;
+
+    seq = (seq + 1) & STREAM_SEQ_MASK;
+    frame[0] = STREAM_SYNC;
+    frame[1] = seq | (with_gyro ? STREAM_GYRO : 0);
+
+    if (since_key < STREAM_KEY_EVERY && deltas(v, n, step))
+    {
+        len = STREAM_DELTA_LEN + (with_gyro ? 3 : 0);
+        for (uint8_t i = 0; i < n; i++)
+        {
+            frame[2 + i] = (uint8_t)step[i];
+            sent[i] += (int16_t)step[i] << STREAM_DELTA_SHIFT;
+        }
+        since_key++;
+    }
+    else
+    {
+        len = STREAM_KEY_LEN + (with_gyro ? 6 : 0);
+        frame[1] |= STREAM_KEY;
+        put16(&frame[2], (int16_t)ms);
+        frame[4] = (uint8_t)node_pad;
+        frame[5] = period;
+        for (uint8_t i = 0; i < n; i++)
+        {
+            put16(&frame[6 + 2 * i], v[i]);
+            sent[i] = v[i];
+        }
+        since_key = 0;
+    }
+
+    for (uint8_t i = 1; i < len - 1; i++)
+        sum += frame[i];
+    frame[len - 1] = sum;
+
+    /* a dropped frame breaks the delta chain, so the next one is a key */
+    if (uart_tx_free() < len)
+    {
+        since_key = STREAM_KEY_EVERY;
+        return;
+    }
+
+    for (uint8_t i = 0; i < len; i++)
+        uart_try_send(frame[i]);
+}
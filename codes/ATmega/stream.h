@@ -0,0 +1,67 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+#include "imu.h"
+
+/*
+ * Hub detection mode: the node streams its samples and the hub detects.
+ *
+ * While streaming, local detection is stopped and every sample the detector
+ * would have read is sent instead, at the role's sample period. Samples are
+ * DPCM coded: a delta frame carries each axis as an int8 step of
+ * 1 << STREAM_DELTA_SHIFT raw counts from the value the hub reconstructed
+ * last, and a key frame carries the full values. A key frame is sent every
+ * STREAM_KEY_EVERY samples, after a dropped frame, and whenever a step does
+ * not fit, which is the case for most samples of a strike.
+ *
+ *   byte  0      STREAM_SYNC
+ *   byte  1      STREAM_KEY | STREAM_GYRO flags, sequence number in bits 0-5
+ *   key frames:
+ *   bytes 2-3    sched_now() ms of the sample, little endian
+ *   byte  4      node pad, HIT_PAD_*
+ *   byte  5      sample period, ms
+ *   bytes 6-11   ax, ay, az   int16 LE raw counts
+ *   bytes 12-17  gx, gy, gz   int16 LE raw counts, STREAM_GYRO frames only
+ *   delta frames:
+ *   bytes 2-4    ax, ay, az steps, int8
+ *   bytes 5-7    gx, gy, gz steps, STREAM_GYRO frames only
+ *   last byte    sum of the bytes from 1, mod 256
+ *
+ * A stick at 200 Hz with the gyro needs about 2 kB/s, against 10 kB/s for
+ * the link at 115200. Frames are dropped rather than waited for when the
+ * UART buffer is full.
+ */
+
+#define STREAM_SYNC         0xE5
+#define STREAM_KEY          0x80
+#define STREAM_GYRO         0x40
+#define STREAM_SEQ_MASK     0x3F
+
+#define STREAM_KEY_LEN      13      // +6 with STREAM_GYRO
+#define STREAM_DELTA_LEN    6       // +3 with STREAM_GYRO
+#define STREAM_FRAME_MAX    19
+
+#define STREAM_DELTA_SHIFT  2       // step = 4 counts, about 1 mg / 0.3 dps
+#define STREAM_KEY_EVERY    32
+
+#define STREAM_CMD_START    'H'
+#define STREAM_CMD_STOP     'h'
+
+/*
+ * imu is the sensor that is streamed (the first one on a two-sensor node),
+ * detect_task the sched id of the detection task it replaces; gyro is 1 to
+ * send the gyro as well.
+ */
+void stream_init(const imu_t *imu, char pad, uint8_t period_ms, uint8_t detect_task, uint8_t gyro);
+
+/* Handle a received command byte. Returns 1 if it was a stream command. */
+uint8_t stream_command(int cmd);
+
+/* 1 while the hub detects */
+uint8_t stream_active(void);
+
+/* Periodic task at the sample period; does nothing unless streaming */
+void stream_task(void);
+
+#endif /* STREAM_H */
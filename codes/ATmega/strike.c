@@ -0,0 +1,83 @@
+#include <stddef.h>
+#include "strike.h"
+#include "imu.h"
+#include "hit.h"
+#include "prof.h"
+
+void strike_init(strike_t *s, const strike_role_t *role, const imu_t *imu,
+                 const calib_t *cal, const int16_t rest[3], const int16_t noise[3])
+{
+    int16_t swing_dir[3] = {0, 0, 0};
+
+    swing_dir[role->axis] = role->swing * GRAV_UNIT;
+
+    s->role = role;
+    s->imu = imu;
+    s->cal = cal;
+    s->pad = role->pad;
+    s->amplitude = 0;
+    if (role->orient)
+        orient_init(&s->orient, role->orient, rest);
+    detector_init(&s->det, &role->det, 0, noise[role->axis]);
+    gravity_init(&s->grav, rest, swing_dir);
+    detector_set_sensitivity(&s->det, cal->sensitivity);
+}
+
+uint8_t strike_poll(strike_t *s)
+{
+    int16_t acc[3], gyro[3];
+    int err;
+    prof_t t;
+
+    t = PROF_BEGIN();
+    if (s->role->orient)
+        err = imu_read_acc_gyro(s->imu, acc, gyro);
+    else
+        err = imu_read_acc(s->imu, acc);
+    if (err != 0)
+    {
+        PROF_COUNT(PROF_CNT_I2C_ERROR);
+        return 0;
+    }
+    PROF_END(PROF_I2C, t);
+
+    return strike_update(s, acc, s->role->orient ? gyro : NULL);
+}
+
+uint8_t strike_update(strike_t *s, int16_t acc[3], const int16_t gyro[3])
+{
+    int16_t swing;
+    uint8_t events;
+    prof_t t;
+
+    t = PROF_BEGIN();
+    for (uint8_t i = 0; i < 3; i++)
+        acc[i] -= s->cal->zero_offset[i];
+
+    if (gyro && s->role->orient)
+        orient_update(&s->orient, acc, gyro, s->role->sample_period_ms);
+
+    swing = gravity_update(&s->grav, acc, s->det.state == DET_ARMED);
+    events = detector_update(&s->det, swing, &s->amplitude);
+    PROF_END(PROF_DETECT, t);
+
+    if (!events)
+        return 0;
+
+    t = PROF_BEGIN();
+    if (events & DET_EVENT_ONSET)
+    {
+        if (s->role->orient)
+            s->pad = orient_pad(&s->orient, s->role->pad);
+        hit_send(s->pad);
+    }
+
+    if (events & DET_EVENT_PEAK)
+    {
+        gravity_learn(&s->grav);
+        hit_send_velocity(s->pad, detector_velocity(s->amplitude));
+    }
+    PROF_END(PROF_UART, t);
+
+    return events;
+}
@@ -0,0 +1,59 @@
+#ifndef STRIKE_H
+#define STRIKE_H
+
+#include <stdint.h>
+#include "detector.h"
+#include "gravity.h"
+#include "calib.h"
+#include "imu.h"
+#include "orient.h"
+
+/*
+ * The node detection pipeline shared by every role: read the IMU, remove
+ * the calibrated offsets, project onto the learned swing, run the detector
+ * and send the hit messages. Anything a role shows or lights up is left to
+ * the caller through the returned event bits.
+ *
+ * A role with orientation zones reads the gyro in the same burst, tracks
+ * where the stick points and sends the pad of that zone instead of its own.
+ *
+ * Only uses the imu.h and hit.h interfaces, so the same code runs on the
+ * host against the mocks in codes/Host/mock.
+ */
+
+typedef struct {
+    char     pad;               // HIT_PAD_* sent for each strike
+    uint8_t  axis;              // 0 x, 1 y, 2 z: swing axis until it is learned
+    int8_t   swing;             // +1 / -1: swing direction along that axis
+    uint16_t sample_period_ms;
+    uint8_t  odr;               // IMU_ODR_* the sensor runs at, one sample per period
+    detector_config_t det;      // det.noise_mult is the default sensitivity
+    const orient_config_t *orient;  // virtual pads, NULL: always pad; needs the gyro on
+} strike_role_t;
+
+typedef struct {
+    const strike_role_t *role;
+    const imu_t *imu;
+    const calib_t *cal;
+    detector_t det;
+    gravity_t grav;
+    orient_t orient;            // only used with role->orient
+    char pad;                   // pad of the strike in progress
+    int16_t amplitude;          // raw counts of the last peak
+} strike_t;
+
+/* (Re)start detection from a calibration; call again after recalibrating */
+void strike_init(strike_t *s, const strike_role_t *role, const imu_t *imu,
+                 const calib_t *cal, const int16_t rest[3], const int16_t noise[3]);
+
+/* Take one sample. Returns DET_EVENT_* bits, 0 also on an I2C error. */
+uint8_t strike_poll(strike_t *s);
+
+/*
+ * Run one sample that was already read from s->imu, e.g. by
+ * imu_read_acc_pair() on a two-sensor node. acc is raw and is modified;
+ * gyro is the matching gyro sample, or NULL for a role without zones.
+ */
+uint8_t strike_update(strike_t *s, int16_t acc[3], const int16_t gyro[3]);
+
+#endif /* STRIKE_H */
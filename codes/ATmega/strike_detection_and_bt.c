@@ -7,8 +7,8 @@
 #include "imu.h"
 
 
-#define STRIKE_THRESHOLD   1.8f   
-#define RESET_THRESHOLD   -0.2f   
+#define STRIKE_THRESHOLD   IMU_G_TO_RAW(1.8f)   
+#define RESET_THRESHOLD   IMU_G_TO_RAW(-0.2f)   
 
 #define LED_PORT   PORTB
 #define LED_DDR    DDRB
@@ -37,21 +37,20 @@ int main(void)
     printf("IMU Ready! Starting drum strike detection...\r\n");
 
     uint8_t buf[6];
-    float az;
+    int16_t az;
     strike_state_t state = WAITING_FOR_STRIKE;
 
     while (1)
     {
         if (IMU_readAccBytes(buf) == 0)
         {
-            int16_t raw_z = (int16_t)((buf[5] << 8) | buf[4]);
-            az = raw_z / 4096.0f; 
+            az = (int16_t)((buf[5] << 8) | buf[4]);
             switch(state)
             {
                 case WAITING_FOR_STRIKE:
                     if (az > STRIKE_THRESHOLD)
                     {
-                        //printf("DOWNWARD STRIKE DETECTED! Z=%.2f g\r\n", az);
+                        //printf("DOWNWARD STRIKE DETECTED! Z=%d raw\r\n", az);
                         LED_PORT |= (1 << LED_PIN);  
                         uart_send('3', NULL);        
                         state = STRIKE_DETECTED_WAIT_UP;
@@ -61,7 +60,7 @@ int main(void)
                 case STRIKE_DETECTED_WAIT_UP:
                     if (az < RESET_THRESHOLD)
                     {
-                        //printf("UPWARD MOTION DETECTED. Ready for next strike. Z=%.2f g\r\n", az);
+                        //printf("UPWARD MOTION DETECTED. Ready for next strike. Z=%d raw\r\n", az);
                         LED_PORT &= ~(1 << LED_PIN); 
                         state = WAITING_FOR_STRIKE;
                     }
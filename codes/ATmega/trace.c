@@ -0,0 +1,166 @@
+#include "trace.h"
+#include "imu.h"
+#include "uart.h"
+#include "sched.h"
+#include "power.h"
+
+#define UART_BITS_PER_BYTE  11      // start, 8 data, 2 stop
+#define SAMPLE_TICKS        (250000UL / TRACE_ODR_HZ)   // sample period, 4 us steps
+
+static imu_t *dev;
+static uint8_t saved_acc_odr, saved_gyro_odr;
+static uint8_t active = 0;
+static uint8_t decimate = 1;
+static uint8_t skip = 0;
+static uint8_t seq = 0;
+static uint8_t first;
+static uint16_t last_ms;
+static uint8_t last_sub;
+static int16_t last_acc[3], last_gyro[3];
+static uint8_t fresh = 0;
+
+void trace_init(imu_t *imu, uint32_t link_baud)
+{
+    uint16_t frames_per_s = link_baud / UART_BITS_PER_BYTE / TRACE_FRAME_LEN;
+
+    dev = imu;
+    decimate = (TRACE_ODR_HZ + frames_per_s - 1) / frames_per_s;
+    if (decimate == 0)
+        decimate = 1;
+}
+
+uint8_t trace_command(int cmd)
+{
+    switch (cmd)
+    {
+        case TRACE_CMD_START:
+            if (active)
+                return 1;
+            power_wake();
+            saved_acc_odr = dev->acc_odr;
+            saved_gyro_odr = dev->gyro_odr;
+            if (imu_set_rate(dev, TRACE_ODR, TRACE_ODR) == 0)
+            {
+                active = 1;
+                skip = 0;
+                first = 1;
+                fresh = 0;
+            }
+            return 1;
+        case TRACE_CMD_STOP:
+            if (!active)
+                return 1;
+            active = 0;
+            imu_set_rate(dev, saved_acc_odr, saved_gyro_odr);
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+uint8_t trace_active(void)
+{
+    return active;
+}
+
+/*
+ * Sample periods since the last traced sample, at least 1. A sample that
+ * some other read took first never reaches trace_task(), so counting
+ * periods instead of reads turns it into a gap in the sequence numbers.
+ */
+static uint8_t periods_since(uint16_t ms, uint8_t sub)
+{
+    int32_t ticks = (int32_t)(uint16_t)(ms - last_ms) * 250 + sub - last_sub;
+    uint32_t n;
+
+    if (first || ticks <= 0)
+        return 1;
+
+    n = ((uint32_t)ticks + SAMPLE_TICKS / 2) / SAMPLE_TICKS;
+    if (n == 0)
+        return 1;
+    return n > 255 ? 255 : (uint8_t)n;
+}
+
+uint8_t trace_take(int16_t acc[3], int16_t gyro[3])
+{
+    if (!fresh)
+        return 0;
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        acc[i] = last_acc[i];
+        if (gyro)
+            gyro[i] = last_gyro[i];
+    }
+    fresh = 0;
+    return 1;
+}
+
+uint8_t trace_strike_poll(strike_t *s)
+{
+    int16_t acc[3], gyro[3];
+
+    if (!active)
+        return strike_poll(s);
+
+    if (!trace_take(acc, gyro))
+        return 0;
+
+    return strike_update(s, acc, s->role->orient ? gyro : NULL);
+}
+
+static void put16(uint8_t *p, int16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)((uint16_t)v >> 8);
+}
+
+void trace_task(void)
+{
+    uint8_t frame[TRACE_FRAME_LEN];
+    int16_t acc[3], gyro[3];
+    uint16_t ms;
+    uint8_t sub, sum = 0;
+
+    if (!active || !imu_new_data(dev))
+        return;
+
+    ms = sched_now_fine(&sub);
+    if (imu_read_acc_gyro(dev, acc, gyro) != 0)
+        return;
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        last_acc[i] = acc[i];
+        last_gyro[i] = gyro[i];
+    }
+    fresh = 1;
+
+    seq += periods_since(ms, sub);
+    first = 0;
+    last_ms = ms;
+    last_sub = sub;
+    if (++skip < decimate)
+        return;
+    skip = 0;
+
+    if (uart_tx_free() < TRACE_FRAME_LEN)
+        return;
+
+    frame[0] = TRACE_SYNC;
+    frame[1] = seq;
+    put16(&frame[2], (int16_t)ms);
+    frame[4] = sub;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        put16(&frame[5 + 2 * i], acc[i]);
+        put16(&frame[11 + 2 * i], gyro[i]);
+    }
+    for (uint8_t i = 1; i < TRACE_FRAME_LEN - 1; i++)
+        sum += frame[i];
+    frame[TRACE_FRAME_LEN - 1] = sum;
+
+    for (uint8_t i = 0; i < TRACE_FRAME_LEN; i++)
+        uart_try_send(frame[i]);
+}
@@ -0,0 +1,70 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include "imu.h"
+#include "strike.h"
+
+/*
+ * Raw IMU trace streaming for building detection datasets.
+ *
+ * While tracing, the IMU runs at TRACE_ODR with the gyro on and every new
+ * sample is sent over the link as one binary frame:
+ *
+ *   byte  0      TRACE_SYNC
+ *   byte  1      sequence number, +1 per sensor sample period (gaps = samples not sent)
+ *   bytes 2-3    sched_now() ms, little endian
+ *   byte  4      position within that ms, 4 us steps (0..249)
+ *   bytes 5-10   ax, ay, az   int16 LE raw counts, IMU_ACC_LSB_PER_G per g
+ *   bytes 11-16  gx, gy, gz   int16 LE raw counts, IMU_GYRO_mdps_PER_LSB
+ *   byte  17     sum of bytes 1-16, mod 256
+ *
+ * Stopping restores the rates the sensor ran at before tracing started.
+ * Frames are dropped rather than waited for when the UART buffer is full,
+ * and decimated when the link is too slow for the full rate.
+ *
+ * Reading the output registers clears the sensor's data-ready flag, so
+ * while tracing trace_task() is the only reader of the traced sensor and
+ * detection keeps running on the samples it passes on; the hits the hub
+ * receives line up with the trace. The sequence number counts sample
+ * periods from the frame timestamps, so a sample that some other read
+ * still took (hub detection mode streaming) shows up as a gap.
+ */
+
+#define TRACE_SYNC          0xE3
+#define TRACE_FRAME_LEN     18
+#define TRACE_ODR           IMU_ODR_208HZ
+#define TRACE_ODR_HZ        208
+#define TRACE_PERIOD_MS     2       // poll faster than the sample period
+
+#define TRACE_CMD_START     'T'
+#define TRACE_CMD_STOP      't'
+
+/*
+ * imu is the sensor that is traced (the first one on a two-sensor node);
+ * link_baud decides how many samples are skipped between frames.
+ */
+void trace_init(imu_t *imu, uint32_t link_baud);
+
+/* Handle a received command byte. Returns 1 if it was a trace command. */
+uint8_t trace_command(int cmd);
+
+/* 1 while tracing */
+uint8_t trace_active(void);
+
+/* Periodic task, TRACE_PERIOD_MS; does nothing unless tracing */
+void trace_task(void);
+
+/*
+ * Newest traced sample, if one arrived since the last call: returns 1 and
+ * fills acc and gyro (gyro may be NULL), else 0.
+ */
+uint8_t trace_take(int16_t acc[3], int16_t gyro[3]);
+
+/*
+ * strike_poll() for the traced sensor: while tracing it runs the detector
+ * on the sample from trace_take(), or returns 0 when there is none yet.
+ */
+uint8_t trace_strike_poll(strike_t *s);
+
+#endif /* TRACE_H */
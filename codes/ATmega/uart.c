@@ -1,9 +1,57 @@
 #include <stdio.h>
 #include "uart.h"
 #include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/delay.h>
 #include <stdarg.h>
 #include <string.h>
 
+static volatile uart_stats_t uart_stats;
+
+#ifndef UART_BLOCKING
+static volatile char tx_buf[UART_TX_BUFFER_SIZE];
+static volatile uint8_t tx_head = 0;    // written by uart_send, read by the ISR
+static volatile uint8_t tx_tail = 0;
+static volatile char rx_buf[UART_RX_BUFFER_SIZE];
+static volatile uint8_t rx_head = 0;    // written by the ISR
+static volatile uint8_t rx_tail = 0;
+
+#define TX_MASK (UART_TX_BUFFER_SIZE - 1)
+#define RX_MASK (UART_RX_BUFFER_SIZE - 1)
+
+ISR(USART0_RX_vect)
+{
+    uint8_t status = UCSR0A;
+    char data = UDR0;
+    uint8_t next = (rx_head + 1) & RX_MASK;
+
+    if (status & (1 << DOR0))
+        uart_stats.rx_overflow++;
+    if (status & (1 << FE0))
+        uart_stats.rx_frame_errors++;
+
+    if (next == rx_tail)
+    {
+        uart_stats.rx_overflow++;
+        return;
+    }
+    rx_buf[rx_head] = data;
+    rx_head = next;
+}
+
+ISR(USART0_UDRE_vect)
+{
+    if (tx_head == tx_tail)
+    {
+        UCSR0B &= ~(1 << UDRIE0);
+        return;
+    }
+    UDR0 = tx_buf[tx_tail];
+    tx_tail = (tx_tail + 1) & TX_MASK;
+}
+#endif
+
 void uart_init()
 {
     /*Set baud rate */
@@ -14,11 +62,98 @@ void uart_init()
     /* Set frame format: 2 stop bits, 8 data bits */
     UCSR0C = (1<<UCSZ01) | (1<<UCSZ00); // 8 data bits
     UCSR0C |= (1<<USBS0); // 2 stop bits
+
+#ifndef UART_BLOCKING
+    // Receive complete interrupt; data register empty is enabled while sending
+    UCSR0B |= (1<<RXCIE0);
+    sei();
+#endif
     
     __init_stdout(uart_send);
     __init_stdin(uart_receive);
 }
 
+#ifndef UART_BLOCKING
+
+int uart_try_send(char data)
+{
+    uint8_t next = (tx_head + 1) & TX_MASK;
+
+    if (next == tx_tail)
+    {
+        uart_stats.tx_overflow++;
+        return -1;
+    }
+    tx_buf[tx_head] = data;
+    tx_head = next;
+    UCSR0B |= (1 << UDRIE0);
+    return 0;
+}
+
+int uart_send(char data, FILE* stream)
+{
+    uint8_t next = (tx_head + 1) & TX_MASK;
+
+    // Only waits when the buffer is full
+    while (next == tx_tail);
+    tx_buf[tx_head] = data;
+    tx_head = next;
+    UCSR0B |= (1 << UDRIE0);
+    return 0;
+}
+
+int uart_receive(FILE* stream)
+{
+    char data;
+
+    while (rx_head == rx_tail);
+    data = rx_buf[rx_tail];
+    rx_tail = (rx_tail + 1) & RX_MASK;
+    return data;
+}
+
+int uart_try_receive(void)
+{
+    char data;
+
+    if (rx_head == rx_tail)
+        return -1;
+    data = rx_buf[rx_tail];
+    rx_tail = (rx_tail + 1) & RX_MASK;
+    return (unsigned char)data;
+}
+
+uint8_t uart_tx_free(void)
+{
+    return (tx_tail - tx_head - 1) & TX_MASK;
+}
+
+int uart_flush(uint16_t timeout_ms)
+{
+    uint16_t ticks = timeout_ms * 10;
+
+    while (tx_head != tx_tail || (UCSR0B & (1 << UDRIE0)))
+    {
+        if (ticks-- == 0)
+            return -1;
+        _delay_us(100);
+    }
+    return 0;
+}
+
+#else /* UART_BLOCKING */
+
+int uart_try_send(char data)
+{
+    if (!(UCSR0A & (1 << UDRE0)))
+    {
+        uart_stats.tx_overflow++;
+        return -1;
+    }
+    UDR0 = data;
+    return 0;
+}
+
 int uart_send(char data, FILE* stream)
 {
     // Wait for empty transmit buffer
@@ -34,6 +169,54 @@ int uart_receive(FILE* stream)
     return UDR0;
 }
 
+int uart_try_receive(void)
+{
+    if (!(UCSR0A & (1 << RXC0)))
+        return -1;
+    return UDR0;
+}
+
+uint8_t uart_tx_free(void)
+{
+    return (UCSR0A & (1 << UDRE0)) ? 1 : 0;
+}
+
+int uart_flush(uint16_t timeout_ms)
+{
+    uint16_t ticks = timeout_ms * 10;
+
+    while (!(UCSR0A & (1 << UDRE0)))
+    {
+        if (ticks-- == 0)
+            return -1;
+        _delay_us(100);
+    }
+    return 0;
+}
+
+#endif /* UART_BLOCKING */
+
+void uart_get_stats(uart_stats_t *stats)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        stats->tx_overflow = uart_stats.tx_overflow;
+        stats->rx_overflow = uart_stats.rx_overflow;
+        stats->rx_frame_errors = uart_stats.rx_frame_errors;
+    }
+}
+
+void uart_set_baud(uint32_t baud)
+{
+    uint16_t ubrr = (F_CPU + 4UL * baud) / (8UL * baud) - 1;
+
+    uart_flush(100);
+    _delay_ms(2);   // let the last byte leave the shift register
+    UCSR0A |= (1<<U2X0);
+    UBRR0H = (unsigned char)(ubrr>>8);
+    UBRR0L = (unsigned char)ubrr;
+}
+
 void determine_line_ending() {
     char c;
     printf("Press Enter to detect the line ending style...\n");
@@ -2,6 +2,7 @@
 #define UART_H
 
 #include <stdio.h>
+#include <stdint.h>
 
 /***************************************/
 /* USER CONFIG */
@@ -35,6 +36,18 @@
  */
 #define UART_BAUD_RATE      9600
 
+/**
+ * Interrupt-driven transmit and receive ring buffers.
+ * Sizes must be powers of two, at most 256 bytes.
+ * uart_send() only waits when the transmit buffer is full.
+ *
+ * Define UART_BLOCKING to use the original polled driver instead,
+ * where every byte waits for the data register.
+ */
+#define UART_TX_BUFFER_SIZE 64
+#define UART_RX_BUFFER_SIZE 32
+// #define UART_BLOCKING
+
 /***************************************/
 /* MACROS AND FUNCTION DECLARATIONS */
 /***************************************/
@@ -46,12 +59,47 @@
 
 #define UART_BAUD_PRESCALER (((F_CPU / (UART_BAUD_RATE * 16UL))) - 1)
 
+#ifndef UART_BLOCKING
+#if (UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)) || UART_TX_BUFFER_SIZE > 256
+#error "UART_TX_BUFFER_SIZE must be a power of two, at most 256"
+#endif
+#if (UART_RX_BUFFER_SIZE & (UART_RX_BUFFER_SIZE - 1)) || UART_RX_BUFFER_SIZE > 256
+#error "UART_RX_BUFFER_SIZE must be a power of two, at most 256"
+#endif
+#endif
+
+typedef struct {
+    uint16_t tx_overflow;   // bytes refused by uart_try_send() on a full buffer
+    uint16_t rx_overflow;   // bytes lost to a full receive buffer or hardware overrun
+    uint16_t rx_frame_errors;
+} uart_stats_t;
+
 void uart_init(void);
 
 int uart_send(char data, FILE* stream);
 
 int uart_receive(FILE* stream);
 
+/* Queue a byte without waiting. Returns 0, or -1 if the buffer is full */
+int uart_try_send(char data);
+
+/* Returns the next received byte, or -1 immediately if none is waiting */
+int uart_try_receive(void);
+
+/* Bytes uart_try_send() will currently accept */
+uint8_t uart_tx_free(void);
+
+/* Wait until everything queued has been handed to the hardware. Returns 0, or -1 on timeout */
+int uart_flush(uint16_t timeout_ms);
+
+void uart_get_stats(uart_stats_t *stats);
+
+/*
+ * Change the baud rate at run time (double speed mode, so 115200 is within
+ * 2.5% at 16 MHz). Waits for queued bytes to go out first.
+ */
+void uart_set_baud(uint32_t baud);
+
 void uart_scanf(const char* format, ...);
 
 void determine_line_ending(void);
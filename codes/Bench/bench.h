@@ -0,0 +1,34 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/*
+ * Stage markers shared by the benchmark firmware and the simavr harness.
+ *
+ * The firmware writes a stage id to GPIOR0 when a stage starts and the id
+ * with BENCH_END set when it finishes; the harness timestamps every write
+ * with the simulated cycle count. Stages may nest.
+ */
+
+#define BENCH_MARK_ADDR     0x3E    // GPIOR0 in data space
+#define BENCH_END           0x80
+
+#define BENCH_REPORT        0x7E    // UART text after this is the RAM report
+#define BENCH_DONE          0x7F    // firmware finished, stop the simulation
+
+enum {
+    BENCH_SAMPLE = 1,               // one full iteration of the sample loop
+    BENCH_I2C_READ,                 // IMU_readAccRaw(): 6-byte TWI burst
+    BENCH_TO_MG,                    // IMU_readAcc_mg(): read plus float conversion
+    BENCH_STRIKE,                   // strike_poll(): read, gravity, detector, hit bytes
+    BENCH_DETECT,                   // gravity_update() + detector_update() alone
+    BENCH_FORMAT,                   // fmt_raw_g() of one value for the display
+    BENCH_UART,                     // queueing a 3-byte hit message
+    BENCH_STAGES
+};
+
+#define BENCH_STAGE_NAMES { \
+    "", "sample", "i2c_read", "to_mg", "strike", "detect", "format", "uart" }
+
+#define BENCH_SAMPLES       500
+
+#endif /* BENCH_H */
@@ -0,0 +1,146 @@
+/*
+ * Benchmark firmware: the node hot paths in a fixed loop, bracketed with
+ * stage markers (bench.h) for bench_sim to time. Runs the right hand role
+ * on the real i2c.c, imu.c, uart.c and detection code.
+ *
+ * RAM: the free RAM between the end of .bss and the top of the stack is
+ * painted at reset; after the loop the untouched part gives the stack
+ * high-water mark, which is printed over the UART with the static usage.
+ */
+#define F_CPU 16000000UL
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
+#include "bench.h"
+#include "uart.h"
+#include "imu.h"
+#include "fmt.h"
+#include "calib.h"
+#include "roles.h"
+#include "hit.h"
+
+#define BENCH_BEGIN(stage)  (GPIOR0 = (stage))
+#define BENCH_FINISH(stage) (GPIOR0 = BENCH_END | (stage))
+
+#define STACK_PAINT         0xC5
+
+extern uint8_t __data_start;
+extern uint8_t _end;
+extern uint8_t __stack;
+
+static const strike_role_t role = ROLE_RIGHT_HAND;
+
+static calib_t cal;
+static int16_t rest[3], noise[3];
+static strike_t strike;
+
+void paint_ram(void) __attribute__((naked, used, section(".init3")));
+void paint_ram(void)
+{
+    uint8_t *p = &_end;
+
+    while (p <= &__stack)
+        *p++ = STACK_PAINT;
+}
+
+static void send_text(const char *s)
+{
+    while (*s)
+        uart_send(*s++, NULL);
+}
+
+static void send_value(const char *label, uint32_t value)
+{
+    char buf[12];
+
+    send_text(label);
+    fmt_uint(buf, value);
+    send_text(buf);
+    send_text("\n");
+}
+
+static void report_ram(void)
+{
+    uint16_t free_bytes = 0;
+    uint8_t *p = &_end;
+
+    while (p <= &__stack && *p == STACK_PAINT)
+    {
+        free_bytes++;
+        p++;
+    }
+
+    GPIOR0 = BENCH_REPORT;
+    send_value("static ", (uint16_t)(&_end - &__data_start));
+    send_value("stack ", (uint16_t)(&__stack - &_end + 1) - free_bytes);
+    send_value("free ", free_bytes);
+    uart_flush(100);
+}
+
+int main(void)
+{
+    int16_t acc[3];
+    float mg[3];
+    char text[12];
+    uint8_t events;
+    detector_t det;             // scratch copies, so the real state is untouched
+    gravity_t grav;
+    int16_t swing, amplitude;
+
+    uart_init();
+    if (IMU_init(0x6B) < 0 || calib_boot(&cal, IMU_device(), role.det.noise_mult, rest, noise) < 0)
+    {
+        GPIOR0 = BENCH_DONE;
+        while (1);
+    }
+    strike_init(&strike, &role, IMU_device(), &cal, rest, noise);
+
+    for (uint16_t n = 0; n < BENCH_SAMPLES; n++)
+    {
+        BENCH_BEGIN(BENCH_SAMPLE);
+
+        BENCH_BEGIN(BENCH_I2C_READ);
+        IMU_readAccRaw(&acc[0], &acc[1], &acc[2]);
+        BENCH_FINISH(BENCH_I2C_READ);
+
+        BENCH_BEGIN(BENCH_TO_MG);
+        IMU_readAcc_mg(&mg[0], &mg[1], &mg[2]);
+        BENCH_FINISH(BENCH_TO_MG);
+
+        BENCH_BEGIN(BENCH_STRIKE);
+        events = strike_poll(&strike);
+        BENCH_FINISH(BENCH_STRIKE);
+
+        /* the detection arithmetic without the bus, on the sample read above */
+        for (uint8_t i = 0; i < 3; i++)
+            acc[i] -= cal.zero_offset[i];
+        det = strike.det;
+        grav = strike.grav;
+        BENCH_BEGIN(BENCH_DETECT);
+        swing = gravity_update(&grav, acc, det.state == DET_ARMED);
+        detector_update(&det, swing, &amplitude);
+        BENCH_FINISH(BENCH_DETECT);
+
+        BENCH_BEGIN(BENCH_FORMAT);
+        fmt_raw_g(text, strike.amplitude, 2);
+        BENCH_FINISH(BENCH_FORMAT);
+
+        if (events & DET_EVENT_PEAK)
+        {
+            BENCH_BEGIN(BENCH_UART);
+            hit_send(role.pad);
+            hit_send_velocity(role.pad, detector_velocity(strike.amplitude));
+            BENCH_FINISH(BENCH_UART);
+        }
+
+        BENCH_FINISH(BENCH_SAMPLE);
+    }
+
+    report_ram();
+
+    GPIOR0 = BENCH_DONE;
+    cli();
+    sleep_enable();
+    sleep_cpu();
+    while (1);
+}
@@ -0,0 +1,244 @@
+/*
+ * Run the benchmark firmware under simavr and report cycles per stage.
+ *
+ * The ATmega328PB runs bench_fw.elf with a simulated LSM6 on the TWI bus
+ * (lsm6_model.c) and the UART captured. Every write to the GPIOR0 marker
+ * register is timestamped with the cycle counter, giving min/mean/max
+ * cycles per stage (bench.h), and the firmware's RAM report is echoed.
+ *
+ * Usage: bench_sim [-t trace] [-b budget_cycles] [-B baseline] [-u] bench_fw.elf
+ *   -t  drive the IMU from a drum trace v1 file instead of the built-in script
+ *   -b  fail if a sample iteration ever takes more cycles than this
+ *   -B  compare max cycles per stage with a baseline file, failing on any
+ *       stage more than BENCH_TOLERANCE_PCT slower; with -u, rewrite it
+ *
+ * Exit status: 0 ok, 1 budget or baseline exceeded, 2 simulation error.
+ */
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "avr_twi.h"
+#include "avr_uart.h"
+#include "bench.h"
+#include "lsm6_model.h"
+#include "trace_file.h"
+
+#define BENCH_MCU           "atmega328pb"
+#define BENCH_FREQ          16000000UL
+#define BENCH_TOLERANCE_PCT 5
+#define BENCH_MAX_CYCLES    (BENCH_FREQ * 60)   // give up after a simulated minute
+
+typedef struct {
+    uint64_t start;
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+} stage_stats_t;
+
+static const char *const stage_names[] = BENCH_STAGE_NAMES;
+static stage_stats_t stages[BENCH_STAGES];
+static int done = 0;
+static int reporting = 0;
+
+static void marker_write(avr_t *avr, avr_io_addr_t addr, uint8_t v, void *param)
+{
+    uint8_t id = v & ~BENCH_END;
+
+    (void)param;
+    avr->data[addr] = v;
+
+    if (v == BENCH_DONE)
+    {
+        done = 1;
+        return;
+    }
+    if (v == BENCH_REPORT)
+    {
+        reporting = 1;
+        return;
+    }
+    if (id == 0 || id >= BENCH_STAGES)
+        return;
+
+    if (!(v & BENCH_END))
+    {
+        stages[id].start = avr->cycle;
+        return;
+    }
+
+    uint64_t cycles = avr->cycle - stages[id].start;
+    stage_stats_t *s = &stages[id];
+    if (s->count == 0 || cycles < s->min)
+        s->min = cycles;
+    if (cycles > s->max)
+        s->max = cycles;
+    s->sum += cycles;
+    s->count++;
+}
+
+static void uart_out(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    (void)irq;
+    (void)param;
+
+    /* hit bytes before the report are just drained */
+    if (reporting)
+        putchar((int)value);
+}
+
+static int check_baseline(const char *path, int update)
+{
+    FILE *f;
+    char name[32];
+    unsigned long long max;
+    int failed = 0;
+
+    if (update)
+    {
+        f = fopen(path, "w");
+        if (!f)
+        {
+            perror(path);
+            return -1;
+        }
+        for (int i = 1; i < BENCH_STAGES; i++)
+            fprintf(f, "%s %" PRIu64 "\n", stage_names[i], stages[i].max);
+        fclose(f);
+        printf("baseline written to %s\n", path);
+        return 0;
+    }
+
+    f = fopen(path, "r");
+    if (!f)
+    {
+        perror(path);
+        return -1;
+    }
+    while (fscanf(f, "%31s %llu", name, &max) == 2)
+    {
+        for (int i = 1; i < BENCH_STAGES; i++)
+        {
+            if (strcmp(name, stage_names[i]) != 0 || stages[i].count == 0)
+                continue;
+            if (stages[i].max * 100 > max * (100 + BENCH_TOLERANCE_PCT))
+            {
+                printf("REGRESSION %s: %" PRIu64 " cycles, baseline %llu\n",
+                       name, stages[i].max, max);
+                failed = 1;
+            }
+        }
+    }
+    fclose(f);
+    return failed;
+}
+
+int main(int argc, char **argv)
+{
+    elf_firmware_t fw;
+    avr_t *avr;
+    lsm6_model_t imu;
+    trace_t trace, *script = NULL;
+    uint64_t budget = 0;
+    const char *baseline = NULL;
+    int update = 0, state, opt, status = 0;
+    uint32_t flags = 0;
+
+    while ((opt = getopt(argc, argv, "t:b:B:u")) != -1)
+    {
+        switch (opt)
+        {
+            case 't':
+                if (trace_load(optarg, &trace) < 0)
+                    return 2;
+                script = &trace;
+                break;
+            case 'b': budget = strtoull(optarg, NULL, 0); break;
+            case 'B': baseline = optarg; break;
+            case 'u': update = 1; break;
+            default:
+                fprintf(stderr, "usage: bench_sim [-t trace] [-b budget_cycles] [-B baseline] [-u] bench_fw.elf\n");
+                return 2;
+        }
+    }
+    if (optind >= argc)
+        return 2;
+
+    memset(&fw, 0, sizeof(fw));
+    if (elf_read_firmware(argv[optind], &fw) != 0)
+    {
+        fprintf(stderr, "%s: cannot read firmware\n", argv[optind]);
+        return 2;
+    }
+
+    avr = avr_make_mcu_by_name(BENCH_MCU);
+    if (!avr)
+    {
+        fprintf(stderr, "simavr has no %s core\n", BENCH_MCU);
+        return 2;
+    }
+    avr_init(avr);
+    avr->frequency = BENCH_FREQ;
+    avr_load_firmware(avr, &fw);
+
+    avr_register_io_write(avr, BENCH_MARK_ADDR, marker_write, NULL);
+
+    lsm6_model_init(avr, &imu, 0x6B, script);
+    lsm6_model_attach(avr, &imu, AVR_IOCTL_TWI_GETIRQ(0));
+
+    avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+    flags &= ~AVR_UART_FLAG_STDIO;
+    avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+    avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT),
+                            uart_out, NULL);
+
+    do {
+        state = avr_run(avr);
+    } while (!done && state != cpu_Done && state != cpu_Crashed && avr->cycle < BENCH_MAX_CYCLES);
+
+    /* let the firmware's report drain through the UART */
+    while (state != cpu_Done && state != cpu_Crashed && avr->cycle < BENCH_MAX_CYCLES)
+        state = avr_run(avr);
+
+    if (state == cpu_Crashed || stages[BENCH_SAMPLE].count == 0)
+    {
+        fprintf(stderr, "simulation failed after %" PRIu64 " cycles\n", avr->cycle);
+        return 2;
+    }
+
+    printf("\n%-10s %8s %10s %10s %10s %10s\n", "stage", "count", "min", "mean", "max", "max_us");
+    for (int i = 1; i < BENCH_STAGES; i++)
+    {
+        const stage_stats_t *s = &stages[i];
+
+        if (s->count == 0)
+            continue;
+        printf("%-10s %8" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10.1f\n",
+               stage_names[i], s->count, s->min, s->sum / s->count, s->max,
+               s->max * 1e6 / BENCH_FREQ);
+    }
+    printf("TWI bursts served: %" PRIu32 "\n", imu.reads);
+
+    if (budget && stages[BENCH_SAMPLE].max > budget)
+    {
+        printf("BUDGET sample: worst case %" PRIu64 " cycles, budget %" PRIu64 "\n",
+               stages[BENCH_SAMPLE].max, budget);
+        status = 1;
+    }
+
+    if (baseline)
+    {
+        int r = check_baseline(baseline, update);
+        if (r < 0)
+            return 2;
+        if (r > 0)
+            status = 1;
+    }
+
+    return status;
+}
@@ -0,0 +1,141 @@
+#include <math.h>
+#include <string.h>
+#include "lsm6_model.h"
+#include "sim_io.h"
+#include "avr_twi.h"
+
+#define LSM_WHO_AM_I        0x0F
+#define LSM_STATUS          0x1E
+#define LSM_OUTX_L_G        0x22
+#define LSM_OUTX_L_XL       0x28
+#define LSM6_WHO_AM_I_VAL   0x6C
+
+#define LSB_PER_G           4096
+#define STRIKE_PERIOD_S     0.4
+#define STRIKE_AT_S         0.3     // impact time within each period
+#define RING_HZ             35.0
+#define RING_TAU_S          0.012
+
+static const char *irq_names[2] = {
+    [TWI_IRQ_INPUT] = "8>lsm6.in",
+    [TWI_IRQ_OUTPUT] = "32<lsm6.out",
+};
+
+static void put16(uint8_t *p, int16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)((uint16_t)v >> 8);
+}
+
+/* Fill the output registers for the current simulated time */
+static void update_outputs(lsm6_model_t *m)
+{
+    double t = (double)m->avr->cycle / m->avr->frequency;
+    int16_t acc[3] = {0, 0, LSB_PER_G};
+    int16_t gyro[3] = {0, 0, 0};
+
+    if (m->trace && m->trace->n_samples)
+    {
+        const trace_t *tr = m->trace;
+        uint32_t span = tr->samples[tr->n_samples - 1].t_us - tr->samples[0].t_us + 1;
+        uint32_t t_us = tr->samples[0].t_us + (uint32_t)(t * 1e6) % span;
+
+        if (tr->samples[m->cursor].t_us > t_us)
+            m->cursor = 0;
+        while (m->cursor + 1 < tr->n_samples && tr->samples[m->cursor + 1].t_us <= t_us)
+            m->cursor++;
+        memcpy(acc, tr->samples[m->cursor].acc, sizeof(acc));
+        memcpy(gyro, tr->samples[m->cursor].gyro, sizeof(gyro));
+    }
+    else
+    {
+        double dt = fmod(t, STRIKE_PERIOD_S) - STRIKE_AT_S;
+
+        if (dt >= 0.0)
+            acc[1] = (int16_t)(-4.0 * LSB_PER_G * exp(-dt / RING_TAU_S) * cos(2.0 * M_PI * RING_HZ * dt));
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        put16(&m->regs[LSM_OUTX_L_G + 2 * i], gyro[i]);
+        put16(&m->regs[LSM_OUTX_L_XL + 2 * i], acc[i]);
+    }
+}
+
+static uint8_t read_reg(lsm6_model_t *m)
+{
+    uint8_t reg = m->reg++ & 0x7F;
+
+    /* latch all outputs at the start of a burst, like the BDU setting */
+    if (reg == LSM_OUTX_L_G || reg == LSM_OUTX_L_XL)
+    {
+        update_outputs(m);
+        m->reads++;
+    }
+    return m->regs[reg];
+}
+
+static void twi_hook(struct avr_irq_t *irq, uint32_t value, void *param)
+{
+    lsm6_model_t *m = param;
+    avr_twi_msg_irq_t v;
+
+    (void)irq;
+    v.u.v = value;
+
+    if (v.u.twi.msg & TWI_COND_STOP)
+        m->selected = 0;
+
+    if (v.u.twi.msg & (TWI_COND_START | TWI_COND_ADDR))
+    {
+        m->selected = 0;
+        m->index = 0;
+        if ((v.u.twi.addr >> 1) == m->addr7)
+        {
+            m->selected = v.u.twi.addr;
+            avr_raise_irq(m->irq + TWI_IRQ_INPUT,
+                          avr_twi_irq_msg(TWI_COND_ACK, m->selected, 1));
+        }
+    }
+
+    if (!m->selected)
+        return;
+
+    if (v.u.twi.msg & TWI_COND_WRITE)
+    {
+        avr_raise_irq(m->irq + TWI_IRQ_INPUT,
+                      avr_twi_irq_msg(TWI_COND_ACK, m->selected, 1));
+        /* first byte is the register address, then data, auto-incrementing */
+        if (m->index++ == 0)
+            m->reg = v.u.twi.data;
+        else if (m->reg < sizeof(m->regs))
+            m->regs[m->reg++] = v.u.twi.data;
+    }
+
+    if (v.u.twi.msg & TWI_COND_READ)
+    {
+        avr_raise_irq(m->irq + TWI_IRQ_INPUT,
+                      avr_twi_irq_msg(TWI_COND_READ, m->selected, read_reg(m)));
+    }
+}
+
+void lsm6_model_init(avr_t *avr, lsm6_model_t *m, uint8_t addr7, const trace_t *trace)
+{
+    memset(m, 0, sizeof(*m));
+    m->avr = avr;
+    m->addr7 = addr7;
+    m->trace = trace;
+    m->regs[LSM_WHO_AM_I] = LSM6_WHO_AM_I_VAL;
+    m->regs[LSM_STATUS] = 0x07;     // accel, gyro and temperature ready
+
+    m->irq = avr_alloc_irq(&avr->irq_pool, 0, 2, irq_names);
+    avr_irq_register_notify(m->irq + TWI_IRQ_OUTPUT, twi_hook, m);
+}
+
+void lsm6_model_attach(avr_t *avr, lsm6_model_t *m, uint32_t twi_irq_base)
+{
+    avr_connect_irq(m->irq + TWI_IRQ_INPUT,
+                    avr_io_getirq(avr, twi_irq_base, TWI_IRQ_INPUT));
+    avr_connect_irq(avr_io_getirq(avr, twi_irq_base, TWI_IRQ_OUTPUT),
+                    m->irq + TWI_IRQ_OUTPUT);
+}
@@ -0,0 +1,35 @@
+#ifndef LSM6_MODEL_H
+#define LSM6_MODEL_H
+
+#include <stdint.h>
+#include "sim_avr.h"
+#include "sim_irq.h"
+#include "trace_file.h"
+
+/*
+ * LSM6 accelerometer/gyro on the simulated TWI bus.
+ *
+ * Answers WHO_AM_I, accepts control register writes and serves the output
+ * registers from a script evaluated at the current simulated time: either
+ * a drum trace v1 file (looped) or a built-in pattern of one stick strike
+ * every 400 ms. STATUS always reports new data.
+ */
+
+typedef struct {
+    avr_irq_t *irq;
+    avr_t *avr;
+    uint8_t addr7;
+    uint8_t selected;
+    uint8_t index;              // bytes written since the address
+    uint8_t reg;                // auto-incrementing register pointer
+    uint8_t regs[0x80];
+    const trace_t *trace;       // NULL for the built-in script
+    size_t cursor;
+    uint32_t reads;             // output register bursts served
+} lsm6_model_t;
+
+void lsm6_model_init(avr_t *avr, lsm6_model_t *m, uint8_t addr7, const trace_t *trace);
+
+void lsm6_model_attach(avr_t *avr, lsm6_model_t *m, uint32_t twi_irq_base);
+
+#endif /* LSM6_MODEL_H */
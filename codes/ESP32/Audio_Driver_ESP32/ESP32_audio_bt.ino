@@ -1,12 +1,19 @@
 #include <BluetoothSerial.h>
+#include <WiFi.h>
+#include <WebSocketsServer.h>
 #include "driver/i2s.h"
 #include "WavData.h"
+#include "esp_partition.h"
 HardwareSerial HC05(2);
 
 #define BTN1 13
 #define BTN2 12
 #define BTN3 14
 
+#define HC05_RX 16
+#define HC05_TX 17
+#define HC05_KEY 5      // KEY (EN) of the wired HC-05, high for AT commands
+
 
 #define BCLK 27
 #define LRCLK 26
@@ -19,26 +26,461 @@ BluetoothSerial SerialBT;
 uint8_t hc05Address[6] = {0x00, 0x18, 0x91, 0xD6, 0xD7, 0x26};
 
 
+#define SAMPLE_RATE 44100
+#define MIX_BLOCK 64            // frames rendered per i2s_write()
+#define I2S_DMA_BUFS 8
+#define I2S_DMA_LEN 1024
+#define I2S_QUEUE_FRAMES (I2S_DMA_BUFS * I2S_DMA_LEN)   // audio queued ahead once the DMA is full
+
+// Synthesis voices cost no flash per sound. A DRUM is a sine swept down
+// from startHz to endHz (kicks, toms), a SNARE adds high-passed noise to a
+// short tone body, and a METAL is a sine phase-modulated at an inharmonic
+// ratio plus noise (cymbals). Velocity scales the level, the pitch sweep,
+// the decay and the modulation index. Everything per sample is integer:
+// Q32 phases, Q31 envelopes and a 1024-entry sine table.
+enum { VOICE_SAMPLE, VOICE_SYNTH, VOICE_STREAM };
+enum { SYNTH_DRUM, SYNTH_SNARE, SYNTH_METAL };
+
+typedef struct {
+    uint8_t kind;
+    uint16_t startHz;       // tone at the hit, swept toward endHz
+    uint16_t endHz;
+    uint16_t sweepMs;       // pitch time constant
+    uint16_t decayMs;       // level time constant at full velocity
+    uint8_t noise;          // noise share, 0..255
+    uint16_t ratio;         // METAL modulator / carrier, 1/256ths
+} SYNTH_PATCH_T;
+
+typedef struct {
+    const SYNTH_PATCH_T* patch;
+    uint8_t velocity;
+    uint32_t phase, inc, incEnd;    // Q32 turn per sample
+    uint32_t incDelta, sweepCoef;   // inc - incEnd, decaying by sweepCoef (Q32)
+    uint32_t amp, ampCoef;          // tone level Q31
+    uint32_t noiseAmp, noiseCoef;   // noise level Q31
+    uint32_t modPhase, modInc;
+    int32_t index;                  // METAL phase offset per unit of modulator
+    uint32_t seed;
+    int32_t lp;                     // noise high-pass state
+} SYNTH_T;
+
+#define SYNTH_SILENT (1UL << 23)    // level at which a synth voice ends, -48 dB
+
+// Streaming voices play samples too long to keep in the app image (cymbal
+// tails, loops) from the "samples" flash partition in partitions.csv. The
+// partition holds a bank: a header of BANK_ENTRY_T and the 16-bit PCM
+// after it. Any pad whose name has a bank entry plays that entry instead of
+// its WAV or synth patch.
+//
+// The first STREAM_CHUNK bytes of each entry are kept in RAM so a hit
+// starts at once. After that each streaming voice plays from two chunk
+// buffers, and prefetchTask() on core 0 refills the one just played while
+// the other plays, 23 ms ahead per mono chunk. A flash read stalls the
+// cache on both cores for about 50 us per chunk, and loop() stalls with it:
+// only the render functions are in IRAM, mixAudio() still calls into flash
+// (metronome, looper, sequencer, startPad) and the WAVs are read from flash.
+// The DMA keeps playing from the I2S_QUEUE_FRAMES queued ahead (186 ms), so
+// the stall costs no audio. A buffer not refilled in time plays silence and
+// counts as an underrun.
+#define BANK_MAGIC 0x424D5244       // "DRMB"
+#define BANK_VERSION 1
+#define BANK_NAME_LEN 16
+#define BANK_MAX_ENTRIES 16
+#define BANK_PARTITION "samples"
+#define BANK_SUBTYPE 0x40
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+} BANK_HEADER_T;
+
+typedef struct {
+    char name[BANK_NAME_LEN];   // matches PAD_T.name, NUL padded
+    uint32_t offset;            // from the start of the partition, 4-byte aligned
+    uint32_t size;              // bytes of PCM
+    uint32_t rate;              // must be SAMPLE_RATE
+    uint16_t channels;
+    uint16_t reserved;
+} BANK_ENTRY_T;
+
+#define STREAM_CHUNK 2048
+#define MAX_STREAMS 4
+#define STREAM_POLL_MS 5
+
+typedef struct {
+    uint8_t entry;              // index into bankEntries[]
+    uint32_t fetched;           // bytes of the entry read into buffers so far
+    uint8_t buf[2][STREAM_CHUNK];
+    uint16_t len[2];
+    volatile bool ready[2];     // filled by prefetchTask(), emptied by the mixer
+    uint8_t cur;
+    uint16_t pos;
+    volatile bool busy;
+    volatile bool inflight;     // prefetchTask() is reading into buf[], the slot can't be reused
+    uint32_t gen;               // bumped per hit, so a read for the previous one is dropped
+} STREAM_T;
+
 typedef struct {
+    uint8_t type;
     const unsigned char* data;
     uint32_t idx;
     uint32_t size;
+    uint8_t channels;   // 1 or 2, read from the WAV or bank header
+    SYNTH_T synth;
+    int8_t stream;      // slot in streams[] of a VOICE_STREAM
     bool active;
+    uint8_t pad;
+    uint8_t gain;       // 1..127, set from the hit velocity
+    uint32_t started;   // voice age, for stealing the oldest
 } PLAYBACK_T;
 
-#define MAX_SOUNDS 3
+#define MAX_SOUNDS 8
 PLAYBACK_T sounds[MAX_SOUNDS];
+uint32_t voiceCounter = 0;
+uint64_t mixFrames = 0;     // frames rendered since boot
+
+
+// Node hit protocol (codes/ATmega/hit.h): the pad character is sent at
+// strike onset, then HIT_VELOCITY_FLAG | pad, 0x80 | velocity at the peak.
+#define HIT_VELOCITY_FLAG 0xF0
+#define HIT_DEFAULT_VELOCITY 100
+#define NUM_PADS 10             // '1'..'9'
+
+const SYNTH_PATCH_T synthKick     = { SYNTH_DRUM,  160, 50,  30,  150, 0,   0 };
+const SYNTH_PATCH_T synthSnare    = { SYNTH_SNARE, 240, 180, 20,  150, 170, 0 };
+const SYNTH_PATCH_T synthHighTom  = { SYNTH_DRUM,  260, 180, 60,  180, 0,   0 };
+const SYNTH_PATCH_T synthFloorTom = { SYNTH_DRUM,  140, 90,  80,  280, 0,   0 };
+const SYNTH_PATCH_T synthCrash    = { SYNTH_METAL, 420, 420, 1,   900, 140, 376 };
+const SYNTH_PATCH_T synthRide     = { SYNTH_METAL, 620, 620, 1,  1400, 60,  366 };
+
+typedef struct {
+    const char* name;
+    const unsigned char* wav;
+    const SYNTH_PATCH_T* synth;
+} PAD_T;
+
+// Pads 1-3 are the node pads in codes/ATmega/hit.h
+const PAD_T pads[NUM_PADS] = {
+    { "",      NULL,  NULL },
+    { "snare", snare, NULL },
+    { "hihat", hihat, NULL },
+    { "kick",  kick,  NULL },
+    { "skick", NULL,  &synthKick },
+    { "ssnare", NULL, &synthSnare },
+    { "htom",  NULL,  &synthHighTom },
+    { "ftom",  NULL,  &synthFloorTom },
+    { "crash", NULL,  &synthCrash },
+    { "ride",  NULL,  &synthRide },
+};
+int8_t lastVoice[NUM_PADS] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };
+int8_t padEntry[NUM_PADS] = { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 };     // bank entry, -1 if none
+
+const esp_partition_t* bankPartition;
+BANK_ENTRY_T bankEntries[BANK_MAX_ENTRIES];
+uint8_t* bankHeads[BANK_MAX_ENTRIES];
+STREAM_T streams[MAX_STREAMS];
+TaskHandle_t prefetchHandle;
+portMUX_TYPE streamMux = portMUX_INITIALIZER_UNLOCKED;
+volatile uint32_t streamUnderruns = 0;
+uint32_t streamReads = 0, streamReadUsMax = 0;
+
+#define SINE_BITS 10
+int16_t sineTable[1 << SINE_BITS];
+
+// Link setup and self-test (codes/ATmega/hc05.h). Both ends of the wired
+// HC-05 run at LINK_BAUD when AT configuration works, LINK_FALLBACK_BAUD
+// otherwise. Pings are answered on the link they arrived on.
+#define LINK_BAUD 115200
+#define LINK_FALLBACK_BAUD 9600
+#define LINK_AT_BAUD 38400
+#define LINK_PING 0xE0
+#define LINK_PONG 0xE1
+#define LINK_BURST 0xE2
+
+// Raw IMU trace frames (codes/ATmega/trace.h) are forwarded unchanged to
+// USB for codes/Python/trace_capture.py; 'T' / 't' from USB start and stop
+// tracing on the nodes.
+#define TRACE_SYNC 0xE3
+#define TRACE_FRAME_LEN 18
+#define TRACE_CMD_START 'T'
+#define TRACE_CMD_STOP 't'
+
+// Node timing stats frames (codes/ATmega/prof.h) are checked and printed to
+// USB as one "STATS" text line each; 'S' from USB asks the nodes for one now.
+#define PROF_SYNC 0xE4
+#define PROF_FRAME_LEN 57
+#define PROF_CMD_STATS 'S'
+#define PROF_PROBES 4
+#define LINK_FRAME_MAX PROF_FRAME_LEN
+
+// 'Z' from USB re-zeroes the sticks' yaw (codes/ATmega/orient.h): point
+// each stick at its own pad and send it
+#define ORIENT_CMD_ZERO 'Z'
+
+// Calibration (codes/ATmega/calib.h): 'C' from USB re-measures every node's
+// rest level and noise, '+' / '-' make the nodes more / less sensitive
+#define CALIB_CMD_RUN 'C'
+#define CALIB_CMD_MORE '+'
+#define CALIB_CMD_LESS '-'
+
+// Hub detection mode (codes/ATmega/stream.h): a node that is sent 'H' stops
+// detecting and streams DPCM-coded samples instead. loop() decodes them and
+// queues them to hubDetectTask() on core 0, which runs a float detector per
+// link and queues the hits back to loop() for the voices. 'H' / 'h' from USB
+// switch every node; HUB_DETECT_BT / HUB_DETECT_HC05 pick the mode each link
+// starts in. A "HUBDET" line per streaming link every HUB_REPORT_MS (and on
+// 'S') gives the bandwidth and the latency the hub adds, to choose between
+// edge and hub detection per node.
+#define STREAM_SYNC 0xE5
+#define STREAM_KEY 0x80
+#define STREAM_GYRO 0x40
+#define STREAM_SEQ_MASK 0x3F
+#define STREAM_KEY_LEN 13
+#define STREAM_DELTA_LEN 6
+#define STREAM_DELTA_SHIFT 2
+#define STREAM_CMD_START 'H'
+#define STREAM_CMD_STOP 'h'
+
+#define HUB_DETECT_BT false
+#define HUB_DETECT_HC05 false
+#define HUB_LINKS 2             // BT, wired HC-05
+#define HUB_REPORT_MS 10000
+#define HUB_QUEUE_LEN 32
+
+#define ACC_LSB_PER_G 4096.0f     // codes/ATmega/imu.h, +/-8 g
+#define GYRO_DPS_PER_LSB 0.070f
+#define STICK_YAW_AXIS 1          // up axis of STICK_MOUNT in codes/ATmega/roles.h
+
+#define HUB_PREDICT_MIN 0.6f      // fire a sample early from this share of the threshold
+#define HUB_PEAK_DROP 0.7f        // peak is over once the signal falls below this share of it
+#define HUB_PEAK_MAX_MS 40
+#define HUB_REARM 0.5f            // share of the threshold to fall below before the next onset
+#define HUB_BASE_ALPHA 0.02f      // gravity tracking while below HUB_REARM
+#define HUB_STILL_G 0.15f         // below this and HUB_STILL_DPS the gyro bias is learned
+#define HUB_STILL_DPS 10.0f
+#define HUB_BIAS_ALPHA 0.02f
+
+// USB runs faster than the 9600 it used to so trace frames fit
+#define USB_BAUD 115200
+
+// Once loop() runs, everything for USB goes through one queue that
+// usbFlush() writes only as fast as the UART takes it, so a burst of hit,
+// beat, step or trace output never stalls the mixer on a full UART FIFO.
+// A message that does not fit is dropped whole and counted.
+#define USB_OUT_LEN 4096            // bytes, a power of two
+#define USB_LINE_MAX 384            // longest line, a STATS report
+
+enum { LINK_IDLE, LINK_PING_SEQ, LINK_BURST_LEN, LINK_BURST_DATA, LINK_TRACE, LINK_STATS, LINK_STREAM, LINK_METRO, LINK_LOOP, LINK_SEQ };
+
+typedef struct {
+    Stream* port;           // where pongs are sent back, NULL for WebSocket
+    uint8_t link;           // index into hubLinks[], HUB_LINKS for USB and WebSocket
+    uint8_t pendingPad;     // pad waiting for its velocity byte, 0 if none
+    uint8_t state;
+    uint8_t burstLeft;      // filler bytes still to discard
+    uint8_t frame[LINK_FRAME_MAX];
+    uint8_t frameLen;
+    uint8_t frameWant;      // length of the stream frame being received
+} LINK_PARSER_T;
+
+LINK_PARSER_T btParser = { &SerialBT, 0 };
+LINK_PARSER_T hc05Parser = { &HC05, 1 };
+LINK_PARSER_T usbParser = { &Serial, HUB_LINKS };
+LINK_PARSER_T netParser = { NULL, HUB_LINKS };     // WebSocket clients
+
+// Stream decoder and link measurements, loop() side
+typedef struct {
+    bool haveKey;           // deltas apply to value[] only after a key frame
+    uint8_t seq;
+    uint8_t pad;
+    uint8_t periodMs;
+    int16_t value[6];
+    uint32_t bytes, frames, keys, drops, bad;
+    uint16_t lagRef;        // clock offset of the window's first key frame
+    int32_t lagSum;
+    int16_t lagMin, lagMax;
+    uint32_t lagCount;
+} HUB_LINK_T;
+
+typedef struct {
+    uint8_t link;
+    uint8_t pad;            // node's home pad number
+    uint8_t periodMs;
+    bool gyro;
+    bool gap;               // samples were lost before this one
+    int16_t value[6];       // ax, ay, az, gx, gy, gz raw counts
+    uint32_t arrivedUs;
+} HUB_SAMPLE_T;
+
+typedef struct {
+    uint8_t pad;
+    uint8_t velocity;       // 0 for the onset
+} HUB_HIT_T;
+
+enum { HUB_DET_IDLE, HUB_DET_PEAK, HUB_DET_REFRACTORY };
+
+// Detector state, hubDetectTask() side
+typedef struct {
+    bool seeded;
+    uint8_t state;
+    uint8_t hitPad;
+    int16_t heldMs;         // time in the peak or refractory state
+    float base[3];          // gravity, g
+    float prev;             // last dynamic acceleration, g
+    float peak;
+    float yaw, yawBias;     // degrees, dps
+    volatile bool zeroYaw;
+    uint32_t count, usSum, usMax, hits;     // under hubStatsMux
+} HUB_DETECTOR_T;
+
+typedef struct {
+    float onsetG;           // dynamic acceleration of an onset
+    float fullG;            // peak that gives velocity 127
+    int16_t refractoryMs;
+} HUB_DET_PARAMS_T;
+
+// Per home pad; the thresholds are above the node roles' as the hub sees
+// the full vector rather than one axis
+const HUB_DET_PARAMS_T hubParams[] = {
+    { 0.0f, 0.0f, 0 },
+    { 2.0f, 8.0f, 60 },     // snare: right stick
+    { 2.0f, 8.0f, 60 },     // hi-hat: left stick
+    { 1.0f, 4.0f, 80 },     // kick pedal
+};
+
+#define HUB_PARAM_PADS (int)(sizeof(hubParams) / sizeof(hubParams[0]))
+
+// Pad zones of the sticks, as RIGHT_HAND_ZONES / LEFT_HAND_ZONES
+typedef struct {
+    uint8_t home;
+    float yawMin, yawMax;
+    uint8_t pad;
+} HUB_ZONE_T;
+
+const HUB_ZONE_T hubZones[] = {
+    { 1, 25.0f, 120.0f, 2 },
+    { 2, -120.0f, -25.0f, 1 },
+};
+
+HUB_LINK_T hubLinks[HUB_LINKS];
+HUB_DETECTOR_T hubDetectors[HUB_LINKS];
+portMUX_TYPE hubStatsMux = portMUX_INITIALIZER_UNLOCKED;   // detector counters: counted on core 0, reported on core 1
+QueueHandle_t sampleQueue;
+QueueHandle_t hitQueue;
+
+// Web UIs (codes/HTML/showing.html) connect over WebSocket on NET_PORT. The
+// audio engine owns core 1: loop() mixes, parses the links and posts hits,
+// velocities, STEP and BEAT events to a lock-free single-producer ring.
+// netTask() on core 0, with the WiFi stack, drains the ring, formats the
+// events as the same lines USB gets and batches them into one text frame
+// per client every NET_FRAME_MS at most. Each client has its own batch: a
+// client whose sends take longer than NET_SLOW_MS is skipped for
+// NET_BACKOFF_MS, its events dropped and counted, and disconnected after
+// NET_SLOW_LIMIT slow sends in a row. Nothing on core 1 ever waits for
+// the network; a full ring drops the event. Text from a client (score
+// lines) goes back through a second ring and is parsed like USB.
+//
+// A client that sends a binary message of NET_VERSION gets binary frames
+// from then on, text lines otherwise. All fields little endian:
+//   events, hub to client:
+//   byte  0      NET_VERSION
+//   byte  1      NET_MSG_EVENTS
+//   bytes 2-3    record count
+//   bytes 4-7    anchor frame, low 32 bits of the mixer frame count
+//   bytes 8-11   anchor ms, millis() at which the anchor frame leaves the DAC
+//   then NET_RECORD_LEN bytes per event:
+//   byte  0      NET_HIT, NET_VELOCITY, NET_STEP, NET_BEAT or NET_SEQ_END
+//   byte  1      pad
+//   byte  2      velocity, or the beat
+//   byte  3      subdivision of a beat
+//   bytes 4-7    step number, or the bar
+//   bytes 8-11   frame, low 32 bits; its ms is
+//                anchor ms + (frame - anchor frame) * 1000 / SAMPLE_RATE
+//   ping, client to hub, every few seconds:
+//   byte  0      NET_VERSION
+//   byte  1      NET_MSG_PING
+//   bytes 2-11   anything, echoed (sequence number, client send time)
+//   pong, answered at once from netTask():
+//   bytes 0-11   the ping, byte 1 NET_MSG_PONG
+//   bytes 12-15  hub millis() on arrival
+// The client takes hub ms = its receive time - rtt / 2 from the pong with
+// the shortest round trip, which puts event times on its own clock.
+// A record is 12 bytes against 15-35 for a line.
+#define HUB_WIFI true
+#define WIFI_SSID "iPhone"
+#define WIFI_PASSWORD "aaaaaaaa"
+#define NET_PORT 81
+#define NET_QUEUE_LEN 256           // events, a power of two
+#define NET_RX_LEN 4096             // bytes from clients, a power of two
+#define NET_CLIENTS WEBSOCKETS_SERVER_CLIENT_MAX
+#define NET_BATCH_MAX 1024
+#define NET_LINE_MAX 48
+#define NET_VERSION 1
+#define NET_MSG_EVENTS 1
+#define NET_MSG_PING 2
+#define NET_MSG_PONG 3
+#define NET_HEADER_LEN 12
+#define NET_RECORD_LEN 12
+#define NET_PING_LEN 12
+#define NET_PONG_LEN 16
+#define NET_FRAME_MS 10
+#define NET_SLOW_MS 20
+#define NET_BACKOFF_MS 500
+#define NET_SLOW_LIMIT 3
+
+enum { NET_HIT, NET_VELOCITY, NET_STEP, NET_BEAT, NET_SEQ_END };
+
+typedef struct {
+    uint8_t type;
+    uint8_t pad;            // HIT, VELOCITY, STEP
+    uint8_t value;          // velocity, or the beat
+    uint8_t sub;            // BEAT
+    uint32_t index;         // step number, or the bar
+    uint32_t ms;            // frameMs() of frame
+    uint64_t frame;
+} NET_EVENT_T;
+
+typedef struct {
+    bool connected;
+    bool binary;            // sent a NET_VERSION message
+    uint8_t slow;           // slow sends in a row
+    uint32_t backoffUntil;  // millis() until which the client is skipped
+    uint16_t len;
+    uint8_t batch[NET_BATCH_MAX];
+    uint32_t frames, dropped, pings;
+    uint32_t bytes;
+    uint32_t sendUsMax;
+} NET_CLIENT_T;
+
+// Indices run free and are only written by their own side
+NET_EVENT_T netQueue[NET_QUEUE_LEN];
+uint32_t netHead = 0, netTail = 0;
+uint32_t netDepthMax = 0;
+volatile uint32_t netQueueDropped = 0;
+uint8_t netRx[NET_RX_LEN];
+uint32_t netRxHead = 0, netRxTail = 0;
+
+WebSocketsServer wsServer(NET_PORT);
+NET_CLIENT_T netClients[NET_CLIENTS];
+portMUX_TYPE netStatsMux = portMUX_INITIALIZER_UNLOCKED;    // client counters: counted on core 0, reported on core 1
+bool netStarted = false;
+
+// Only used from loop(), on core 1
+uint8_t usbOut[USB_OUT_LEN];
+uint32_t usbOutHead = 0, usbOutTail = 0;
+uint32_t usbOutDepthMax = 0, usbOutDropped = 0;
 
 
 static const i2s_config_t i2s_config = {
     .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX),
-    .sample_rate = 44100,
+    .sample_rate = SAMPLE_RATE,
     .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
     .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
     .communication_format = I2S_COMM_FORMAT_I2S_MSB,
     .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-    .dma_buf_count = 8,
-    .dma_buf_len = 1024,
+    .dma_buf_count = I2S_DMA_BUFS,
+    .dma_buf_len = I2S_DMA_LEN,
     .use_apll = 0,
     .tx_desc_auto_clear = true,
 };
@@ -51,146 +493,2038 @@ static const i2s_pin_config_t pin_config = {
 };
 
 
-void playSound(const unsigned char* wav)
+void usbWrite(const uint8_t* data, size_t len)
+{
+    uint32_t depth = usbOutHead - usbOutTail;
+
+    if (depth + len > USB_OUT_LEN)
+    {
+        usbOutDropped++;
+        return;
+    }
+    for (size_t i = 0; i < len; i++) usbOut[(usbOutHead + i) % USB_OUT_LEN] = data[i];
+    usbOutHead += len;
+    if (depth + len > usbOutDepthMax) usbOutDepthMax = depth + len;
+}
+
+
+void usbPrintf(const char* fmt, ...)
+{
+    char line[USB_LINE_MAX];
+    va_list args;
+
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n < 0) return;
+    usbWrite((const uint8_t*)line, n < (int)sizeof(line) ? n : sizeof(line) - 1);
+}
+
+
+// Called from loop(): never more than the UART has room for
+void usbFlush()
+{
+    int room = Serial.availableForWrite();
+
+    while (room > 0 && usbOutTail != usbOutHead)
+    {
+        uint32_t at = usbOutTail % USB_OUT_LEN;
+        uint32_t n = usbOutHead - usbOutTail;
+
+        if (n > USB_OUT_LEN - at) n = USB_OUT_LEN - at;
+        if (n > (uint32_t)room) n = room;
+        Serial.write(&usbOut[at], n);
+        usbOutTail += n;
+        room -= n;
+    }
+}
+
+
+void printUsbStats()
+{
+    usbPrintf("USB queue %lu/%d dropped %lu\n", (unsigned long)usbOutDepthMax, USB_OUT_LEN,
+              (unsigned long)usbOutDropped);
+    usbOutDepthMax = 0;
+    usbOutDropped = 0;
+}
+
+
+uint32_t mulQ32(uint32_t a, uint32_t b)
+{
+    return (uint32_t)(((uint64_t)a * b) >> 32);
+}
+
+
+uint32_t hzToInc(float hz)
+{
+    return (uint32_t)(hz * (4294967296.0 / SAMPLE_RATE));
+}
+
+
+// Per-sample multiplier that decays by 1/e in ms
+uint32_t decayCoef(float ms)
+{
+    return ms > 0 ? (uint32_t)(exp(-1000.0 / (ms * SAMPLE_RATE)) * 4294967295.0) : 0;
+}
+
+
+void buildSineTable()
+{
+    for (int i = 0; i < (1 << SINE_BITS); i++)
+    {
+        sineTable[i] = (int16_t)(32767.0 * sin(2.0 * M_PI * i / (1 << SINE_BITS)));
+    }
+}
+
+
+// Velocity shapes the sweep depth, the decay and the modulation index. It
+// can change a few ms into the voice, when the velocity byte arrives, so the
+// sweep still in progress is rescaled rather than restarted.
+void synthSetVelocity(SYNTH_T* s, uint8_t velocity)
+{
+    const SYNTH_PATCH_T* p = s->patch;
+    float v = velocity / 127.0f;
+    float depth = 0.5f + 0.5f * v;
+
+    if (s->velocity) s->incDelta = (uint32_t)(s->incDelta * depth / (0.5f + 0.5f * s->velocity / 127.0f));
+    else s->incDelta = (uint32_t)((hzToInc(p->startHz) - hzToInc(p->endHz)) * depth);
+    s->inc = s->incEnd + s->incDelta;
+    s->velocity = velocity;
+
+    float decayMs = p->decayMs * (0.4f + 0.6f * v);
+    s->noiseCoef = decayCoef(decayMs);
+    s->ampCoef = decayCoef(p->kind == SYNTH_SNARE ? decayMs / 3 : decayMs);
+    s->index = velocity * 512;
+}
+
+
+void synthStart(SYNTH_T* s, const SYNTH_PATCH_T* p, uint8_t velocity)
+{
+    memset(s, 0, sizeof(*s));
+    s->patch = p;
+    s->incEnd = hzToInc(p->endHz);
+    s->sweepCoef = decayCoef(p->sweepMs);
+    s->modInc = (uint32_t)((uint64_t)hzToInc(p->startHz) * p->ratio >> 8);
+    s->amp = 0x7FFFFFFF;
+    s->noiseAmp = p->noise ? 0x7FFFFFFF : 0;
+    s->seed = 0x12345678 ^ esp_random();
+    synthSetVelocity(s, velocity);
+}
+
+
+int32_t IRAM_ATTR synthRender(SYNTH_T* s)
+{
+    const SYNTH_PATCH_T* p = s->patch;
+    int32_t tone, out;
+
+    if (p->kind == SYNTH_METAL)
+    {
+        int32_t m = sineTable[s->modPhase >> (32 - SINE_BITS)];
+        s->modPhase += s->modInc;
+        tone = sineTable[(s->phase + (uint32_t)(m * s->index)) >> (32 - SINE_BITS)];
+    }
+    else
+    {
+        tone = sineTable[s->phase >> (32 - SINE_BITS)];
+    }
+    s->phase += s->inc;
+    s->incDelta = mulQ32(s->incDelta, s->sweepCoef);
+    s->inc = s->incEnd + s->incDelta;
+
+    out = (tone * (int32_t)(s->amp >> 16)) >> 15;
+    s->amp = mulQ32(s->amp, s->ampCoef);
+
+    if (p->noise)
+    {
+        // xorshift32, then a one-pole high-pass
+        s->seed ^= s->seed << 13;
+        s->seed ^= s->seed >> 17;
+        s->seed ^= s->seed << 5;
+        int32_t n = (int16_t)(s->seed >> 16);
+        s->lp += (n - s->lp) >> 3;
+        n = ((n - s->lp) * (int32_t)(s->noiseAmp >> 16)) >> 15;
+        s->noiseAmp = mulQ32(s->noiseAmp, s->noiseCoef);
+        out = (out * (256 - p->noise) + n * p->noise) >> 8;
+    }
+    return out;
+}
+
+
+bool IRAM_ATTR streamRender(STREAM_T* st, uint8_t channels, int32_t* left, int32_t* right)
+{
+    if (!st->ready[st->cur])
+    {
+        if (st->fetched >= bankEntries[st->entry].size) return false;
+        streamUnderruns++;
+        *left = *right = 0;
+        return true;
+    }
+
+    const int16_t* pcm = (const int16_t*)(st->buf[st->cur] + st->pos);
+    *left = pcm[0];
+    *right = (channels == 2) ? pcm[1] : pcm[0];
+    st->pos += 2 * channels;
+
+    if (st->pos >= st->len[st->cur])
+    {
+        st->ready[st->cur] = false;
+        st->cur ^= 1;
+        st->pos = 0;
+        xTaskNotifyGive(prefetchHandle);
+    }
+    return true;
+}
+
+
+// One frame of one voice, before its gain; false once the voice has ended
+bool IRAM_ATTR renderVoice(PLAYBACK_T* v, int32_t* left, int32_t* right)
+{
+    if (v->type == VOICE_SYNTH)
+    {
+        if (v->synth.amp < SYNTH_SILENT && v->synth.noiseAmp < SYNTH_SILENT) return false;
+        *left = *right = synthRender(&v->synth);
+        return true;
+    }
+    if (v->type == VOICE_STREAM) return streamRender(&streams[v->stream], v->channels, left, right);
+
+    if (v->idx >= v->size) return false;
+    *left = *(const int16_t*)(v->data + v->idx);
+    *right = (v->channels == 2) ? *(const int16_t*)(v->data + v->idx + 2) : *left;
+    v->idx += 2 * v->channels;
+    return true;
+}
+
+
+void stopVoice(PLAYBACK_T* v)
+{
+    v->active = false;
+    if (v->type == VOICE_STREAM)
+    {
+        portENTER_CRITICAL(&streamMux);
+        streams[v->stream].busy = false;
+        portEXIT_CRITICAL(&streamMux);
+        v->type = VOICE_SAMPLE;
+    }
+}
+
+
+// A free voice, or the oldest one when all are playing
+int allocVoice(uint8_t pad)
 {
+    int pick = -1;
+
     for (int i = 0; i < MAX_SOUNDS; i++)
     {
         if (!sounds[i].active)
         {
-            uint32_t dataSize = *(uint32_t*)(wav + 40);   
-            sounds[i].data = wav + 44;                    
-            sounds[i].idx = 0;
-            sounds[i].size = dataSize;
-            sounds[i].active = true;
-            return;
+            pick = i;
+            break;
         }
+        if (pick < 0 || sounds[i].started < sounds[pick].started) pick = i;
     }
+
+    stopVoice(&sounds[pick]);
+    sounds[pick].pad = pad;
+    sounds[pick].gain = HIT_DEFAULT_VELOCITY;
+    sounds[pick].started = ++voiceCounter;
+    return pick;
 }
 
 
-void IRAM_ATTR mixAudio()
+int playSound(const unsigned char* wav, uint8_t pad = 0)
 {
-    int16_t left = 0;
-    int16_t right = 0;
+    int i = allocVoice(pad);
 
-    for (int i = 0; i < MAX_SOUNDS; i++)
-    {
-        if (sounds[i].active)
-        {
-            if (sounds[i].idx >= sounds[i].size)
-            {
-                sounds[i].active = false;
-                continue;
-            }
+    sounds[i].type = VOICE_SAMPLE;
+    sounds[i].channels = *(const uint16_t*)(wav + 22);
+    sounds[i].data = wav + 44;
+    sounds[i].idx = 0;
+    sounds[i].size = *(const uint32_t*)(wav + 40);
+    sounds[i].active = true;
+    return i;
+}
 
-            int16_t sL = *(int16_t*)(sounds[i].data + sounds[i].idx);
-            int16_t sR = *(int16_t*)(sounds[i].data + sounds[i].idx + 2);
 
-            left += sL / 2;
-            right += sR / 2;
+// -1 when every stream slot is playing, or still has a read in progress
+int playStream(uint8_t entry, uint8_t pad)
+{
+    const BANK_ENTRY_T* e = &bankEntries[entry];
+    int slot = -1;
 
-            sounds[i].idx += 4;
+    portENTER_CRITICAL(&streamMux);
+    for (int i = 0; i < MAX_STREAMS; i++)
+    {
+        if (!streams[i].busy && !streams[i].inflight)
+        {
+            slot = i;
+            break;
         }
     }
+    portEXIT_CRITICAL(&streamMux);
+    if (slot < 0) return -1;
 
-    uint8_t frame[4];
-    frame[0] = left & 0xFF;
-    frame[1] = left >> 8;
-    frame[2] = right & 0xFF;
-    frame[3] = right >> 8;
+    int i = allocVoice(pad);
+    STREAM_T* st = &streams[slot];
+    uint32_t head = e->size < STREAM_CHUNK ? e->size : STREAM_CHUNK;
 
-    size_t bw;
-    i2s_write(I2S_NUM_0, frame, 4, &bw, portMAX_DELAY);
+    portENTER_CRITICAL(&streamMux);
+    st->busy = true;
+    st->gen++;
+    st->entry = entry;
+    st->fetched = head;
+    st->cur = 0;
+    st->pos = 0;
+    st->len[0] = head;
+    st->ready[0] = true;
+    st->ready[1] = false;
+    portEXIT_CRITICAL(&streamMux);
+    memcpy(st->buf[0], bankHeads[entry], head);
+
+    sounds[i].type = VOICE_STREAM;
+    sounds[i].stream = slot;
+    sounds[i].channels = e->channels;
+    sounds[i].active = true;
+    xTaskNotifyGive(prefetchHandle);
+    return i;
 }
 
 
-void setup()
+int playSynth(const SYNTH_PATCH_T* patch, uint8_t pad)
 {
-    Serial.begin(9600);
-    HC05.begin(9600, SERIAL_8N1, 16, 17);
-    HC05.begin(9600, SERIAL_8N1);
+    int i = allocVoice(pad);
 
-    pinMode(BTN1, INPUT_PULLUP);
-    pinMode(BTN2, INPUT_PULLUP);
-    pinMode(BTN3, INPUT_PULLUP);
+    sounds[i].type = VOICE_SYNTH;
+    synthStart(&sounds[i].synth, patch, HIT_DEFAULT_VELOCITY);
+    sounds[i].active = true;
+    return i;
+}
 
 
-    i2s_driver_install(I2S_NUM_0, &i2s_config, 0, NULL);
-    i2s_set_pin(I2S_NUM_0, &pin_config);
-    i2s_set_sample_rates(I2S_NUM_0, 44100);
+void startPad(uint8_t pad)
+{
+    const PAD_T* p = &pads[pad];
+    int v = padEntry[pad] >= 0 ? playStream(padEntry[pad], pad) : -1;
 
+    if (v < 0) v = p->synth ? playSynth(p->synth, pad) : playSound(p->wav, pad);
+    lastVoice[pad] = v;
+}
 
-    if (!SerialBT.begin("ESP32_MASTER", true)) {  
-        Serial.println("Failed to start BT in master mode");
-        while (1) { delay(1000); }
+
+// The velocity arrives a sample or two after the onset, so it is applied to
+// the voice that onset started, if it is still playing.
+void applyVelocity(uint8_t pad, uint8_t velocity)
+{
+    int8_t v = lastVoice[pad];
+    if (v >= 0 && sounds[v].active && sounds[v].pad == pad)
+    {
+        sounds[v].gain = velocity ? velocity : 1;
+        if (sounds[v].type == VOICE_SYNTH) synthSetVelocity(&sounds[v].synth, sounds[v].gain);
     }
-    Serial.println("ESP32 Bluetooth started in master mode");
+}
 
 
-    SerialBT.setPin("1234",4);
+void looperRecord(uint8_t pad);
+void looperVelocity(uint8_t pad, uint8_t velocity);
+uint32_t frameMs(uint64_t frame);
+void netPost(const NET_EVENT_T* e);
 
+// A hit from a node or USB, reported to the UIs as
+//   <pad> <frame> <ms>
+// with the frame its voice starts on, so it can be judged against the
+// sequencer's STEP lines on the same clock
+void triggerPad(uint8_t pad)
+{
+    if (pad == 0 || pad >= NUM_PADS) return;
 
-    if (SerialBT.connect(hc05Address)) {
-        Serial.println("Connected to HC-05!");
-    } else {
-        Serial.println("Failed to connect to HC-05");
-    }
+    NET_EVENT_T e = { NET_HIT, pad, 0, 0, 0, frameMs(mixFrames), mixFrames };
+
+    startPad(pad);
+    looperRecord(pad);
+    usbPrintf("%c %llu %lu\n", '0' + pad, (unsigned long long)mixFrames, (unsigned long)e.ms);
+    netPost(&e);
 }
 
 
-void loop()
+void setPadVelocity(uint8_t pad, uint8_t velocity)
 {
+    if (pad == 0 || pad >= NUM_PADS) return;
 
-    if (digitalRead(BTN1) == 0) playSound(snare);
-    if (digitalRead(BTN2) == 0) playSound(hihat);
-    if (digitalRead(BTN3) == 0) playSound(kick);
+    NET_EVENT_T e = { NET_VELOCITY, pad, velocity, 0, 0, frameMs(mixFrames), mixFrames };
 
-    while (SerialBT.available())
+    applyVelocity(pad, velocity);
+    looperVelocity(pad, velocity);
+    netPost(&e);
+}
+
+
+// Refill the buffer after the one playing, or the playing one after an
+// underrun; up to both in one call
+void streamFill(STREAM_T* st)
+{
+    for (int n = 0; n < 2; n++)
     {
-        char cmd = SerialBT.read();
-        Serial.println(cmd);
+        portENTER_CRITICAL(&streamMux);
+        uint8_t b = st->ready[st->cur] ? st->cur ^ 1 : st->cur;
+        const BANK_ENTRY_T* e = &bankEntries[st->entry];
+        bool want = st->busy && !st->ready[b] && st->fetched < e->size;
+        uint32_t gen = st->gen;
+        uint32_t from = st->fetched;
+        st->inflight = want;
+        portEXIT_CRITICAL(&streamMux);
+        if (!want) return;
 
-        switch (cmd)
+        uint32_t len = e->size - from < STREAM_CHUNK ? e->size - from : STREAM_CHUNK;
+        uint32_t t = micros();
+        bool ok = esp_partition_read(bankPartition, e->offset + from, st->buf[b], len) == ESP_OK;
+        t = micros() - t;
+        streamReads++;
+        if (t > streamReadUsMax) streamReadUsMax = t;
+
+        portENTER_CRITICAL(&streamMux);
+        if (st->gen == gen)
         {
-            case '1': playSound(snare); break;
-            case '2': playSound(hihat); break;
-            case '3': playSound(kick); break;
+            st->len[b] = len;
+            st->fetched = ok ? from + len : e->size;    // a failed read ends the voice
+            st->ready[b] = ok;
         }
+        st->inflight = false;
+        portEXIT_CRITICAL(&streamMux);
     }
+}
 
-    while (HC05.available())
+
+void prefetchTask(void* arg)
+{
+    for (;;)
     {
-        char cmd = HC05.read();
-        Serial.println(cmd);
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STREAM_POLL_MS));
+        for (int i = 0; i < MAX_STREAMS; i++) streamFill(&streams[i]);
+    }
+}
 
-        switch (cmd)
-        {
-            case '1': playSound(snare); break;
-            case '2': playSound(hihat); break;
-            case '3': playSound(kick); break;
-        }
+
+void bankLoad()
+{
+    BANK_HEADER_T h;
+    int loaded = 0;
+
+    bankPartition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, (esp_partition_subtype_t)BANK_SUBTYPE,
+                                             BANK_PARTITION);
+    if (bankPartition == NULL || esp_partition_read(bankPartition, 0, &h, sizeof(h)) != ESP_OK ||
+        h.magic != BANK_MAGIC || h.version != BANK_VERSION)
+    {
+        Serial.println("No sample bank");
+        return;
     }
-    while (Serial.available())
+
+    int n = h.count < BANK_MAX_ENTRIES ? h.count : BANK_MAX_ENTRIES;
+    if (esp_partition_read(bankPartition, sizeof(h), bankEntries, n * sizeof(BANK_ENTRY_T)) != ESP_OK) return;
+
+    for (int i = 0; i < n; i++)
     {
-        char cmd = Serial.read();
-        Serial.println(cmd);
+        BANK_ENTRY_T* e = &bankEntries[i];
+        uint32_t head = e->size < STREAM_CHUNK ? e->size : STREAM_CHUNK;
+
+        e->name[BANK_NAME_LEN - 1] = 0;
+        if (e->rate != SAMPLE_RATE || (e->channels != 1 && e->channels != 2) ||
+            e->offset + e->size > bankPartition->size)
+        {
+            Serial.printf("Bank entry %s skipped\n", e->name);
+            continue;
+        }
+
+        bankHeads[i] = (uint8_t*)malloc(head);
+        if (bankHeads[i] == NULL || esp_partition_read(bankPartition, e->offset, bankHeads[i], head) != ESP_OK) continue;
 
-        switch (cmd)
+        for (int pad = 1; pad < NUM_PADS; pad++)
         {
-            case '1': playSound(snare); break;
-            case '2': playSound(hihat); break;
-            case '3': playSound(kick); break;
+            if (strcmp(pads[pad].name, e->name) == 0) padEntry[pad] = i;
         }
+        loaded++;
     }
+    Serial.printf("Sample bank: %d of %d entries\n", loaded, h.count);
+}
 
 
-    static unsigned long lastTry = 0;
-    if (!SerialBT.connected() && millis() - lastTry > 5000)
+void printStreamStats()
+{
+    usbPrintf("STREAM underruns %lu reads %lu read_max %luus\n", (unsigned long)streamUnderruns,
+              (unsigned long)streamReads, (unsigned long)streamReadUsMax);
+}
+
+
+// Metronome, clocked by the frames the mixer renders, so it cannot drift
+// against the drums. "M<bpm> [beats] [subdivisions] [accent]" on its own
+// line from USB starts it (e.g. "M120 4 2 1": 4/4 in eighths, first beat
+// accented), "M0" stops it. Clicks are a dedicated synth voice that is
+// never stolen. Every tick is announced as
+//   BEAT <bar> <beat> <sub> <frame> <ms>
+// where frame counts rendered frames since boot and ms is the millis()
+// at which the click leaves the DAC, for UIs to align to.
+#define METRO_CMD 'M'
+#define METRO_MAX_BPM 400
+#define METRO_EVENTS 8
+
+typedef struct {
+    bool on;
+    uint16_t bpm;
+    uint8_t beats;          // per bar
+    uint8_t subdiv;         // ticks per beat
+    bool accent;            // first beat of the bar louder and higher
+    uint64_t stepQ16;       // frames per tick, Q16
+    uint64_t nextQ16;       // frame of the next tick, Q16
+    uint32_t tick;          // ticks since start
+} METRO_T;
+
+typedef struct {
+    uint32_t bar;
+    uint8_t beat, sub;
+    uint64_t frame;
+} BEAT_EVENT_T;
+
+const SYNTH_PATCH_T clickAccent = { SYNTH_DRUM, 2000, 2000, 1, 12, 0, 0 };
+const SYNTH_PATCH_T clickBeat   = { SYNTH_DRUM, 1500, 1500, 1, 10, 0, 0 };
+const SYNTH_PATCH_T clickSub    = { SYNTH_DRUM, 1000, 1000, 1, 6,  0, 0 };
+
+METRO_T metro;
+PLAYBACK_T clickVoice;
+BEAT_EVENT_T beatEvents[METRO_EVENTS];
+volatile uint8_t beatHead = 0, beatTail = 0;
+
+
+void metroStart(uint16_t bpm, uint8_t beats, uint8_t subdiv, bool accent)
+{
+    if (bpm == 0 || bpm > METRO_MAX_BPM)
     {
-        lastTry = millis();
-        Serial.println("Reconnecting to HC-05...");
-        SerialBT.connect(hc05Address);
+        metro.on = false;
+        usbPrintf("METRO off\n");
+        return;
+    }
+
+    metro.bpm = bpm;
+    metro.beats = beats ? beats : 4;
+    metro.subdiv = subdiv ? subdiv : 1;
+    metro.accent = accent;
+    metro.stepQ16 = ((uint64_t)SAMPLE_RATE * 60 << 16) / ((uint32_t)bpm * metro.subdiv);
+    metro.nextQ16 = mixFrames << 16;
+    metro.tick = 0;
+    metro.on = true;
+    usbPrintf("METRO %u %u %u %u\n", metro.bpm, metro.beats, metro.subdiv, metro.accent);
+}
+
+
+void metroCommand(const char* line)
+{
+    unsigned bpm = 0, beats = 4, subdiv = 1, accent = 1;
+
+    sscanf(line, "%u %u %u %u", &bpm, &beats, &subdiv, &accent);
+    metroStart(bpm, beats, subdiv, accent != 0);
+}
+
+
+// Called by the mixer on the frame a tick falls on
+void metroTick()
+{
+    uint8_t sub = metro.tick % metro.subdiv;
+    uint8_t beat = (metro.tick / metro.subdiv) % metro.beats;
+    const SYNTH_PATCH_T* patch = sub ? &clickSub : (beat == 0 && metro.accent ? &clickAccent : &clickBeat);
+
+    synthStart(&clickVoice.synth, patch, 127);
+    clickVoice.type = VOICE_SYNTH;
+    clickVoice.gain = sub ? 60 : (patch == &clickAccent ? 127 : 90);
+    clickVoice.active = true;
+
+    uint8_t next = (beatHead + 1) % METRO_EVENTS;
+    if (next != beatTail)
+    {
+        BEAT_EVENT_T* e = &beatEvents[beatHead];
+        e->bar = metro.tick / ((uint32_t)metro.subdiv * metro.beats);
+        e->beat = beat;
+        e->sub = sub;
+        e->frame = mixFrames;
+        beatHead = next;
+    }
+
+    metro.tick++;
+    metro.nextQ16 += metro.stepQ16;
+}
+
+
+// millis() at which a frame leaves the DAC. Valid from loop(): after an
+// i2s_write() returns the queue is full, and the newest frame rendered is
+// I2S_QUEUE_FRAMES from the DAC.
+uint32_t frameMs(uint64_t frame)
+{
+    int64_t ahead = (int64_t)(frame - mixFrames) + I2S_QUEUE_FRAMES;
+
+    return millis() + (int32_t)(ahead * 1000 / SAMPLE_RATE);
+}
+
+
+void printBeats()
+{
+    while (beatTail != beatHead)
+    {
+        const BEAT_EVENT_T* e = &beatEvents[beatTail];
+        NET_EVENT_T n = { NET_BEAT, 0, e->beat, e->sub, e->bar, frameMs(e->frame), e->frame };
+
+        usbPrintf("BEAT %lu %u %u %llu %lu\n", (unsigned long)e->bar, e->beat, e->sub,
+                  (unsigned long long)e->frame, (unsigned long)n.ms);
+        netPost(&n);
+        beatTail = (beatTail + 1) % METRO_EVENTS;
+    }
+}
+
+
+// Looper: records hits into a loop and plays them back from the mixer on
+// the frame they were played on. Events are 8 bytes in a fixed array kept
+// sorted by position, so nothing is allocated; LOOP_MAX_EVENTS fill 32 KB.
+// Each overdub, from Lo on to Lo off however many times the loop goes
+// round, is one layer that can be undone. Commands, one line each from USB:
+//   Lr[bars]  record the first layer. With the metronome on it starts on
+//             the next downbeat and, given bars, stops by itself after
+//             them; otherwise a second Lr (or Lp) sets the length.
+//   Lo        overdub on / off while playing
+//   Lu        undo the last layer
+//   Lp / Ls   play from the top / stop
+//   Lc        clear
+#define LOOP_CMD 'L'
+#define LOOP_MAX_EVENTS 4096
+#define LOOP_MAX_LAYERS 255
+
+enum { LOOP_EMPTY, LOOP_ARMED, LOOP_RECORD, LOOP_PLAY, LOOP_OVERDUB, LOOP_STOPPED };
+
+typedef struct {
+    uint32_t pos;           // frames from the start of the loop
+    uint8_t pad;
+    uint8_t velocity;
+    uint8_t layer;
+    uint8_t reserved;
+} LOOP_EVENT_T;
+
+typedef struct {
+    uint8_t state;
+    uint8_t layer;          // layer being recorded, or the top one
+    uint32_t len;           // frames, 0 while the first layer is open
+    uint32_t pos;           // next frame to render
+    uint64_t startFrame;    // mixFrames at which an armed recording starts
+    uint32_t fixedLen;      // length to close the first layer at, 0 if open
+    uint16_t count;
+    uint16_t cursor;        // next event to play
+    int16_t lastEvent[NUM_PADS];   // recorded onset waiting for its velocity
+} LOOPER_T;
+
+LOOP_EVENT_T loopEvents[LOOP_MAX_EVENTS];
+LOOPER_T looper;
+
+
+bool looperRecording()
+{
+    return looper.state == LOOP_RECORD || looper.state == LOOP_OVERDUB;
+}
+
+
+void looperRecord(uint8_t pad)
+{
+    if (!looperRecording() || looper.count == LOOP_MAX_EVENTS) return;
+
+    // keep the array sorted; the hit goes before any event at the same
+    // position, which moves the cursor past it so it is not replayed now
+    uint32_t pos = looper.pos;
+    int i = looper.count;
+    while (i > 0 && loopEvents[i - 1].pos >= pos) i--;
+    memmove(&loopEvents[i + 1], &loopEvents[i], (looper.count - i) * sizeof(LOOP_EVENT_T));
+    loopEvents[i] = (LOOP_EVENT_T){ pos, pad, HIT_DEFAULT_VELOCITY, looper.layer, 0 };
+    looper.count++;
+    if (i <= looper.cursor) looper.cursor++;
+
+    for (int p = 0; p < NUM_PADS; p++)
+    {
+        if (looper.lastEvent[p] >= i) looper.lastEvent[p]++;
+    }
+    looper.lastEvent[pad] = i;
+}
+
+
+void looperVelocity(uint8_t pad, uint8_t velocity)
+{
+    int i = looper.lastEvent[pad];
+
+    if (i >= 0 && i < looper.count && loopEvents[i].pad == pad) loopEvents[i].velocity = velocity;
+    looper.lastEvent[pad] = -1;
+}
+
+
+void looperClear()
+{
+    looper.state = LOOP_EMPTY;
+    looper.layer = 0;
+    looper.len = 0;
+    looper.pos = 0;
+    looper.count = 0;
+    looper.cursor = 0;
+    for (int p = 0; p < NUM_PADS; p++) looper.lastEvent[p] = -1;
+}
+
+
+void looperUndo()
+{
+    int kept = 0;
+
+    for (int i = 0; i < looper.count; i++)
+    {
+        if (loopEvents[i].layer != looper.layer) loopEvents[kept++] = loopEvents[i];
+    }
+    looper.count = kept;
+    for (int p = 0; p < NUM_PADS; p++) looper.lastEvent[p] = -1;
+
+    if (looper.layer == 0)
+    {
+        looperClear();
+        return;
+    }
+    looper.layer--;
+    if (looper.state == LOOP_OVERDUB) looper.state = LOOP_PLAY;
+
+    // back to the first event not yet played this pass
+    looper.cursor = 0;
+    while (looper.cursor < looper.count && loopEvents[looper.cursor].pos < looper.pos) looper.cursor++;
+}
+
+
+void looperStatus()
+{
+    static const char* const names[] = { "empty", "armed", "record", "play", "overdub", "stopped" };
+
+    usbPrintf("LOOP %s %lums %u events %u layers\n", names[looper.state],
+              (unsigned long)((uint64_t)looper.len * 1000 / SAMPLE_RATE), looper.count,
+              looper.state == LOOP_EMPTY ? 0 : looper.layer + 1);
+}
+
+
+void looperCommand(const char* line)
+{
+    unsigned bars = 0;
+
+    switch (line[0])
+    {
+        case 'r':
+            if (looper.state == LOOP_RECORD && looper.fixedLen == 0)
+            {
+                looper.len = looper.pos;
+                looper.pos = 0;
+                looper.cursor = 0;
+                looper.state = LOOP_PLAY;
+                break;
+            }
+            looperClear();
+            sscanf(line + 1, "%u", &bars);
+            looper.fixedLen = 0;
+            if (metro.on)
+            {
+                uint32_t bar = (uint32_t)metro.beats * metro.subdiv;
+                uint32_t toBar = (bar - metro.tick % bar) % bar;
+
+                looper.startFrame = (metro.nextQ16 + toBar * metro.stepQ16) >> 16;
+                looper.fixedLen = (uint32_t)(((uint64_t)bars * bar * metro.stepQ16) >> 16);
+                looper.state = LOOP_ARMED;
+            }
+            else
+            {
+                looper.state = LOOP_RECORD;
+            }
+            break;
+        case 'o':
+            if (looper.state == LOOP_PLAY && looper.layer < LOOP_MAX_LAYERS)
+            {
+                looper.layer++;
+                looper.state = LOOP_OVERDUB;
+            }
+            else if (looper.state == LOOP_OVERDUB)
+            {
+                looper.state = LOOP_PLAY;
+            }
+            break;
+        case 'u':
+            if (looper.state != LOOP_EMPTY && looper.state != LOOP_ARMED && looper.state != LOOP_RECORD) looperUndo();
+            break;
+        case 'p':
+            if (looper.state == LOOP_RECORD && looper.fixedLen == 0)
+            {
+                looper.len = looper.pos;
+            }
+            if (looper.len)
+            {
+                looper.pos = 0;
+                looper.cursor = 0;
+                looper.state = LOOP_PLAY;
+            }
+            break;
+        case 's':
+            if (looper.len) looper.state = LOOP_STOPPED;
+            break;
+        case 'c':
+            looperClear();
+            break;
+    }
+    looperStatus();
+}
+
+
+// Called by the mixer once per frame, before the frame is rendered
+void looperFrame()
+{
+    if (looper.state == LOOP_ARMED)
+    {
+        if (mixFrames < looper.startFrame) return;
+        looper.state = LOOP_RECORD;
+        looper.pos = 0;
+    }
+    if (looper.state != LOOP_RECORD && looper.state != LOOP_PLAY && looper.state != LOOP_OVERDUB) return;
+
+    while (looper.cursor < looper.count && loopEvents[looper.cursor].pos == looper.pos)
+    {
+        const LOOP_EVENT_T* e = &loopEvents[looper.cursor++];
+        startPad(e->pad);
+        applyVelocity(e->pad, e->velocity);
+    }
+
+    looper.pos++;
+    if (looper.state == LOOP_RECORD && looper.fixedLen && looper.pos >= looper.fixedLen)
+    {
+        looper.len = looper.fixedLen;
+        looper.state = LOOP_PLAY;
+    }
+    if (looper.len && looper.pos >= looper.len)
+    {
+        looper.pos = 0;
+        looper.cursor = 0;
+    }
+}
+
+
+
+// Sequencer: plays a score (codes/HTML/sample_score.txt) against the
+// player on the I2S clock, so the hub is the one timing authority. The UI
+// compiles the score and sends it a line at a time from USB:
+//   Qc                          clear
+//   Qt<bpm> <grid> <steps> <beats>  tempo, steps per beat, length, beats per bar
+//   Qn<step> <pad>              a note for the player to play
+//   Qb<step> <pad>              a backing note the hub plays
+//   Qg<0|1>                     play the player's notes quietly as a guide
+//   Qp[bars]                    play after bars of count-in (default 1)
+//   Qs                          stop
+// Play restarts the metronome at the score tempo as the click, and the end
+// of the score or Qs stops it again. Every note
+// for the player is announced SEQ_ANNOUNCE_MS before it is due as
+//   STEP <n> <pad> <frame> <ms>
+// n counting the player's notes from 0, on the same frame clock as the hit
+// lines, so a UI judges a hit early or late by the difference in frames.
+// "SEQ end" follows once the last step's judging window has passed, so a
+// late hit on a note on the last step still counts.
+#define SEQ_CMD 'Q'
+#define SEQ_MAX_EVENTS 1024
+#define SEQ_GUIDE_VELOCITY 40
+#define SEQ_ANNOUNCE_MS 1000
+#define SEQ_JUDGE_WINDOW_MS 150     // JUDGE_WINDOW_MS of the UIs, at most half a step
+
+enum { SEQ_PLAYER, SEQ_BACKING };
+
+typedef struct {
+    uint16_t step;
+    uint8_t pad;
+    uint8_t part;
+} SEQ_EVENT_T;
+
+typedef struct {
+    bool on;
+    bool ended;             // "SEQ end" still to print
+    bool guide;
+    bool clicks;            // play started the metronome, stop it with the score
+    uint16_t bpm;
+    uint8_t grid;           // steps per beat
+    uint8_t beats;          // per bar
+    uint16_t len;           // steps
+    uint64_t stepQ16;       // frames per step, Q16
+    uint64_t originQ16;     // frame of step 0, Q16
+    uint16_t step;          // next step to play
+    uint64_t nextFrame;     // frame it falls on
+    uint64_t endFrame;      // "SEQ end" is printed from here on
+    uint16_t count;
+    uint16_t cursor;        // next event to play
+    uint16_t announce;      // next event to announce
+    uint16_t announced;     // player notes announced
+} SEQ_T;
+
+SEQ_EVENT_T seqEvents[SEQ_MAX_EVENTS];
+SEQ_T seq;
+
+
+// The first frame at or after the step's exact time, as for metronome ticks
+uint64_t seqStepFrame(uint16_t step)
+{
+    return (seq.originQ16 + step * seq.stepQ16 + 0xFFFF) >> 16;
+}
+
+
+// Events arrive in order; one out of order is moved back to its step
+void seqAdd(uint16_t step, uint8_t pad, uint8_t part)
+{
+    if (seq.on || pad == 0 || pad >= NUM_PADS || seq.count == SEQ_MAX_EVENTS) return;
+
+    int i = seq.count;
+    while (i > 0 && seqEvents[i - 1].step > step) i--;
+    memmove(&seqEvents[i + 1], &seqEvents[i], (seq.count - i) * sizeof(SEQ_EVENT_T));
+    seqEvents[i] = (SEQ_EVENT_T){ step, pad, part };
+    seq.count++;
+    if (step >= seq.len) seq.len = step + 1;
+}
+
+
+void seqStart(unsigned bars)
+{
+    if (seq.bpm == 0 || seq.count == 0) return;
+
+    metroStart(seq.bpm, seq.beats, 1, true);
+    seq.clicks = true;
+    seq.stepQ16 = ((uint64_t)SAMPLE_RATE * 60 << 16) / ((uint32_t)seq.bpm * seq.grid);
+    seq.originQ16 = metro.nextQ16 + (uint64_t)bars * seq.beats * metro.stepQ16;
+    seq.step = 0;
+    seq.nextFrame = seqStepFrame(0);
+    seq.cursor = 0;
+    seq.announce = 0;
+    seq.announced = 0;
+    seq.ended = false;
+    seq.on = true;
+}
+
+
+void seqStop()
+{
+    seq.on = false;
+    if (seq.clicks) metro.on = false;
+    seq.clicks = false;
+}
+
+
+void seqCommand(const char* line)
+{
+    unsigned a = 0, b = 0, c = 0, d = 0;
+
+    switch (line[0])
+    {
+        case 'c':
+            seqStop();
+            memset(&seq, 0, sizeof(seq));
+            break;
+        case 't':
+            if (seq.on) return;
+            sscanf(line + 1, "%u %u %u %u", &a, &b, &c, &d);
+            seq.bpm = (a && a <= METRO_MAX_BPM) ? a : 0;
+            seq.grid = b ? b : 1;
+            if (c > seq.len) seq.len = c;
+            seq.beats = d ? d : 4;
+            break;
+        case 'n':
+        case 'b':
+            if (sscanf(line + 1, "%u %u", &a, &b) == 2) seqAdd(a, b, line[0] == 'n' ? SEQ_PLAYER : SEQ_BACKING);
+            return;
+        case 'g':
+            seq.guide = line[1] == '1';
+            break;
+        case 'p':
+            a = 1;
+            sscanf(line + 1, "%u", &a);
+            seqStart(a);
+            break;
+        case 's':
+            seqStop();
+            break;
+    }
+    usbPrintf("SEQ %s %u bpm %u/%u %u steps %u events guide %u\n", seq.on ? "play" : "stop",
+              seq.bpm, seq.beats, seq.grid, seq.len, seq.count, seq.guide);
+}
+
+
+// Called by the mixer on the frame a step falls on
+void seqTick()
+{
+    while (seq.cursor < seq.count && seqEvents[seq.cursor].step == seq.step)
+    {
+        const SEQ_EVENT_T* e = &seqEvents[seq.cursor++];
+
+        if (e->part == SEQ_BACKING)
+        {
+            startPad(e->pad);
+            applyVelocity(e->pad, HIT_DEFAULT_VELOCITY);
+        }
+        else if (seq.guide)
+        {
+            startPad(e->pad);
+            applyVelocity(e->pad, SEQ_GUIDE_VELOCITY);
+        }
+    }
+
+    if (++seq.step >= seq.len)
+    {
+        uint64_t window = (uint64_t)SEQ_JUDGE_WINDOW_MS * SAMPLE_RATE / 1000;
+
+        if (window > seq.stepQ16 >> 17) window = seq.stepQ16 >> 17;
+        seqStop();
+        seq.ended = true;
+        seq.endFrame = seq.nextFrame + window;
+        return;
+    }
+    seq.nextFrame = seqStepFrame(seq.step);
+}
+
+
+void printSteps()
+{
+    uint64_t horizon = mixFrames + (uint64_t)SEQ_ANNOUNCE_MS * SAMPLE_RATE / 1000;
+
+    while ((seq.on || seq.ended) && seq.announce < seq.count)
+    {
+        const SEQ_EVENT_T* e = &seqEvents[seq.announce];
+        uint64_t frame = seqStepFrame(e->step);
+
+        if (frame > horizon) break;
+        seq.announce++;
+        if (e->part != SEQ_PLAYER) continue;
+
+        NET_EVENT_T n = { NET_STEP, e->pad, 0, 0, seq.announced++, frameMs(frame), frame };
+        usbPrintf("STEP %lu %u %llu %lu\n", (unsigned long)n.index, e->pad, (unsigned long long)frame,
+                  (unsigned long)n.ms);
+        netPost(&n);
+    }
+
+    if (seq.ended && mixFrames >= seq.endFrame)
+    {
+        NET_EVENT_T n = { NET_SEQ_END, 0, 0, 0, 0, frameMs(mixFrames), mixFrames };
+
+        seq.ended = false;
+        usbPrintf("SEQ end\n");
+        netPost(&n);
+    }
+}
+
+#define BENCH_CMD 'B'
+#define BENCH_FRAMES 4096
+
+volatile int32_t benchSink;     // keeps the timed loop from being optimised out
+
+// Cycles per frame of one voice of each pad, against the frame budget at
+// the CPU clock: MAX_SOUNDS of the dearest must fit with room for the rest
+// of loop(). 'B' from USB runs it; audio stalls for a few ms meanwhile.
+void benchVoices()
+{
+    uint32_t budget = getCpuFrequencyMhz() * 1000000UL / SAMPLE_RATE;
+    uint32_t worst = 0;
+    PLAYBACK_T v;
+
+    usbPrintf("BENCH budget %lu cycles/frame\n", (unsigned long)budget);
+    for (int pad = 1; pad < NUM_PADS; pad++)
+    {
+        const PAD_T* p = &pads[pad];
+        int32_t l, r, sink = 0;
+        uint32_t frames = 0;
+
+        memset(&v, 0, sizeof(v));
+        if (p->synth)
+        {
+            v.type = VOICE_SYNTH;
+            synthStart(&v.synth, p->synth, 127);
+        }
+        else
+        {
+            v.type = VOICE_SAMPLE;
+            v.channels = *(const uint16_t*)(p->wav + 22);
+            v.data = p->wav + 44;
+            v.size = *(const uint32_t*)(p->wav + 40);
+        }
+
+        uint32_t start = ESP.getCycleCount();
+        while (frames < BENCH_FRAMES && renderVoice(&v, &l, &r))
+        {
+            sink += l;
+            frames++;
+        }
+        uint32_t cycles = (ESP.getCycleCount() - start) / (frames ? frames : 1);
+
+        if (cycles > worst) worst = cycles;
+        benchSink = sink;
+        usbPrintf("BENCH %c %s %lu cycles/frame\n", '0' + pad, p->name, (unsigned long)cycles);
+    }
+    usbPrintf("BENCH %d voices %lu%% of budget\n", MAX_SOUNDS, (unsigned long)(worst * MAX_SOUNDS * 100 / budget));
+}
+
+
+uint16_t frame16(const uint8_t* f, int i)
+{
+    return f[i] | (f[i + 1] << 8);
+}
+
+void printStats(const uint8_t* f)
+{
+    static const char* const probeNames[PROF_PROBES] = { "i2c", "detect", "display", "uart" };
+    static const char* const counterNames[] = { "i2c_err", "missed", "tx_ovf", "rx_ovf", "frame_err",
+                                                "standby_pm", "wake_ms", "wake_max_ms", "battery_min",
+                                                "link_rtt_ms", "link_lost" };
+    uint8_t sum = 0;
+
+    for (int i = 1; i < PROF_FRAME_LEN - 1; i++) sum += f[i];
+    if (sum != f[PROF_FRAME_LEN - 1]) return;
+
+    // STATS <node> <probe> <min>/<avg>/<max>us x<count> ... <counter> <n> ...
+    // built whole so it is queued, or dropped, as one line
+    char line[USB_LINE_MAX];
+    int n = snprintf(line, sizeof(line), "STATS %c", f[1]);
+    for (int i = 0; i < PROF_PROBES; i++)
+    {
+        const uint8_t* q = &f[2 + 8 * i];
+        n += snprintf(line + n, sizeof(line) - n, " %s %u/%u/%uus x%u", probeNames[i],
+                      frame16(q, 0), frame16(q, 2), frame16(q, 4), frame16(q, 6));
+    }
+    for (int i = 0; i < (int)(sizeof(counterNames) / sizeof(counterNames[0])); i++)
+    {
+        n += snprintf(line + n, sizeof(line) - n, " %s %u", counterNames[i], frame16(f, 2 + 8 * PROF_PROBES + 2 * i));
+    }
+    usbPrintf("%s\n", line);
+}
+
+
+uint8_t streamFrameLen(uint8_t flags)
+{
+    if (flags & STREAM_KEY) return STREAM_KEY_LEN + ((flags & STREAM_GYRO) ? 6 : 0);
+    return STREAM_DELTA_LEN + ((flags & STREAM_GYRO) ? 3 : 0);
+}
+
+
+// Lag is the node-to-hub clock offset of each key frame minus the smallest
+// in the window, i.e. how much later than the fastest frame it arrived. The
+// constant part of the transit, about half the ping round trip in the node's
+// self-test, is not included.
+void measureLag(HUB_LINK_T* h, uint16_t nodeMs)
+{
+    uint16_t offset = (uint16_t)millis() - nodeMs;
+
+    if (h->lagCount == 0)
+    {
+        h->lagRef = offset;
+        h->lagSum = 0;
+        h->lagMin = 0;
+        h->lagMax = 0;
+    }
+
+    int16_t lag = (int16_t)(offset - h->lagRef);
+    h->lagSum += lag;
+    h->lagCount++;
+    if (lag < h->lagMin) h->lagMin = lag;
+    if (lag > h->lagMax) h->lagMax = lag;
+}
+
+
+void decodeStream(uint8_t link, const uint8_t* f, uint8_t len)
+{
+    HUB_LINK_T* h = &hubLinks[link];
+    HUB_SAMPLE_T s;
+    uint8_t n = (f[1] & STREAM_GYRO) ? 6 : 3;
+    uint8_t seq = f[1] & STREAM_SEQ_MASK;
+    uint8_t sum = 0;
+
+    h->bytes += len;
+    for (int i = 1; i < len - 1; i++) sum += f[i];
+    if (sum != f[len - 1])
+    {
+        h->bad++;
+        h->haveKey = false;
+        return;
+    }
+
+    h->frames++;
+    s.gap = !h->haveKey || seq != ((h->seq + 1) & STREAM_SEQ_MASK);
+    if (h->haveKey && s.gap) h->drops += (seq - h->seq - 1) & STREAM_SEQ_MASK;
+    h->seq = seq;
+
+    if (f[1] & STREAM_KEY)
+    {
+        h->keys++;
+        h->pad = f[4] - '0';
+        h->periodMs = f[5];
+        for (int i = 0; i < n; i++) h->value[i] = (int16_t)frame16(f, 6 + 2 * i);
+        h->haveKey = true;
+        measureLag(h, frame16(f, 2));
+    }
+    else
+    {
+        // a lost delta breaks the chain until the next key frame
+        if (s.gap)
+        {
+            h->haveKey = false;
+            return;
+        }
+        for (int i = 0; i < n; i++) h->value[i] += (int16_t)(int8_t)f[2 + i] << STREAM_DELTA_SHIFT;
+    }
+
+    s.link = link;
+    s.pad = h->pad;
+    s.periodMs = h->periodMs;
+    s.gyro = (n == 6);
+    memcpy(s.value, h->value, sizeof(s.value));
+    s.arrivedUs = micros();
+    if (xQueueSend(sampleQueue, &s, 0) != pdTRUE) h->drops++;
+}
+
+
+void hubPostHit(uint8_t pad, uint8_t velocity)
+{
+    HUB_HIT_T hit = { pad, velocity };
+    xQueueSend(hitQueue, &hit, 0);
+}
+
+
+uint8_t hubZonePad(uint8_t home, float yaw)
+{
+    for (int i = 0; i < (int)(sizeof(hubZones) / sizeof(hubZones[0])); i++)
+    {
+        const HUB_ZONE_T* z = &hubZones[i];
+        if (z->home == home && yaw >= z->yawMin && yaw < z->yawMax) return z->pad;
+    }
+    return home;
+}
+
+
+// Multi-axis detector: the magnitude of the acceleration minus gravity,
+// with the onset fired one sample early when the slope says the threshold
+// will be crossed, velocity from the peak, and the pad from the yaw
+void hubDetect(const HUB_SAMPLE_T* s)
+{
+    HUB_DETECTOR_T* d = &hubDetectors[s->link];
+    const HUB_DET_PARAMS_T* cfg = &hubParams[s->pad < HUB_PARAM_PADS ? s->pad : 0];
+    float a[3];
+    float dyn = 0;
+
+    if (cfg->onsetG == 0) return;
+
+    for (int i = 0; i < 3; i++) a[i] = s->value[i] / ACC_LSB_PER_G;
+    if (!d->seeded)
+    {
+        memcpy(d->base, a, sizeof(a));
+        d->seeded = true;
+        d->yaw = 0;
+        d->yawBias = 0;
+    }
+
+    for (int i = 0; i < 3; i++) dyn += (a[i] - d->base[i]) * (a[i] - d->base[i]);
+    dyn = sqrtf(dyn);
+
+    if (s->gyro)
+    {
+        float rate = s->value[3 + STICK_YAW_AXIS] * GYRO_DPS_PER_LSB;
+
+        if (dyn < HUB_STILL_G && fabsf(rate - d->yawBias) < HUB_STILL_DPS)
+            d->yawBias += (rate - d->yawBias) * HUB_BIAS_ALPHA;
+        d->yaw += (rate - d->yawBias) * s->periodMs / 1000.0f;
+        if (d->yaw > 180.0f) d->yaw -= 360.0f;
+        else if (d->yaw < -180.0f) d->yaw += 360.0f;
+    }
+    if (d->zeroYaw)
+    {
+        d->zeroYaw = false;
+        d->yaw = 0;
+    }
+
+    switch (d->state)
+    {
+        case HUB_DET_IDLE:
+        {
+            float slope = dyn - d->prev;
+
+            if (dyn < cfg->onsetG * HUB_REARM)
+            {
+                for (int i = 0; i < 3; i++) d->base[i] += (a[i] - d->base[i]) * HUB_BASE_ALPHA;
+            }
+            if (dyn >= cfg->onsetG ||
+                (!s->gap && slope > 0 && dyn >= cfg->onsetG * HUB_PREDICT_MIN && dyn + slope >= cfg->onsetG))
+            {
+                d->hitPad = s->gyro ? hubZonePad(s->pad, d->yaw) : s->pad;
+                hubPostHit(d->hitPad, 0);
+                portENTER_CRITICAL(&hubStatsMux);
+                d->hits++;
+                portEXIT_CRITICAL(&hubStatsMux);
+                d->peak = dyn;
+                d->heldMs = 0;
+                d->state = HUB_DET_PEAK;
+            }
+            break;
+        }
+        case HUB_DET_PEAK:
+            d->heldMs += s->periodMs;
+            if (dyn > d->peak) d->peak = dyn;
+            if (dyn < d->peak * HUB_PEAK_DROP || d->heldMs >= HUB_PEAK_MAX_MS)
+            {
+                float v = d->peak / cfg->fullG * 127.0f;
+                hubPostHit(d->hitPad, v >= 127.0f ? 127 : (v < 1.0f ? 1 : (uint8_t)v));
+                d->heldMs = 0;
+                d->state = HUB_DET_REFRACTORY;
+            }
+            break;
+        case HUB_DET_REFRACTORY:
+            d->heldMs += s->periodMs;
+            if (d->heldMs >= cfg->refractoryMs && dyn < cfg->onsetG * HUB_REARM) d->state = HUB_DET_IDLE;
+            break;
+    }
+    d->prev = dyn;
+}
+
+
+void hubDetectTask(void* arg)
+{
+    HUB_SAMPLE_T s;
+
+    for (;;)
+    {
+        if (xQueueReceive(sampleQueue, &s, portMAX_DELAY) != pdTRUE) continue;
+
+        hubDetect(&s);
+
+        // queue wait plus detection, from the frame's last byte
+        HUB_DETECTOR_T* d = &hubDetectors[s.link];
+        uint32_t us = micros() - s.arrivedUs;
+        portENTER_CRITICAL(&hubStatsMux);
+        d->count++;
+        d->usSum += us;
+        if (us > d->usMax) d->usMax = us;
+        portEXIT_CRITICAL(&hubStatsMux);
+    }
+}
+
+
+// HUBDET <link> <pad> <B/s> <frames/s> key <n> drop <n> bad <n> lag <avg>/<max>ms det <avg>/<max>us hits <n>
+void printHubStats()
+{
+    static const char* const linkNames[HUB_LINKS] = { "bt", "hc05" };
+    static unsigned long since = 0;
+    uint32_t windowMs = millis() - since;
+
+    since = millis();
+    if (windowMs == 0) return;
+    for (int i = 0; i < HUB_LINKS; i++)
+    {
+        HUB_LINK_T* h = &hubLinks[i];
+        HUB_DETECTOR_T* d = &hubDetectors[i];
+
+        if (h->frames == 0 && h->bad == 0) continue;
+
+        portENTER_CRITICAL(&hubStatsMux);
+        uint32_t count = d->count, usSum = d->usSum, usMax = d->usMax, hits = d->hits;
+        d->count = d->usSum = d->usMax = d->hits = 0;
+        portEXIT_CRITICAL(&hubStatsMux);
+
+        int32_t lagAvg = h->lagCount ? h->lagSum / (int32_t)h->lagCount - h->lagMin : 0;
+        usbPrintf("HUBDET %s %u %luB/s %lufps key %lu drop %lu bad %lu lag %ld/%dms det %lu/%luus hits %lu\n",
+                  linkNames[i], h->pad,
+                  (unsigned long)(h->bytes * 1000 / windowMs), (unsigned long)(h->frames * 1000 / windowMs),
+                  (unsigned long)h->keys, (unsigned long)h->drops, (unsigned long)h->bad,
+                  (long)lagAvg, h->lagMax - h->lagMin,
+                  (unsigned long)(count ? usSum / count : 0), (unsigned long)usMax, (unsigned long)hits);
+
+        h->bytes = h->frames = h->keys = h->drops = h->bad = 0;
+        h->lagCount = 0;
+    }
+}
+
+
+// Audio core only; never waits
+void netPost(const NET_EVENT_T* e)
+{
+    if (!HUB_WIFI) return;
+
+    uint32_t head = netHead;
+    uint32_t depth = head - __atomic_load_n(&netTail, __ATOMIC_ACQUIRE);
+
+    if (depth == NET_QUEUE_LEN)
+    {
+        netQueueDropped++;
+        return;
+    }
+    netQueue[head % NET_QUEUE_LEN] = *e;
+    __atomic_store_n(&netHead, head + 1, __ATOMIC_RELEASE);
+    if (depth + 1 > netDepthMax) netDepthMax = depth + 1;
+}
+
+
+// Network core; waits for loop() to make room, so a score is never cut
+void netRxPut(uint8_t b)
+{
+    while (netRxHead - __atomic_load_n(&netRxTail, __ATOMIC_ACQUIRE) == NET_RX_LEN) vTaskDelay(1);
+    netRx[netRxHead % NET_RX_LEN] = b;
+    __atomic_store_n(&netRxHead, netRxHead + 1, __ATOMIC_RELEASE);
+}
+
+
+int netFormat(const NET_EVENT_T* e, char* line)
+{
+    switch (e->type)
+    {
+        case NET_HIT:
+            return snprintf(line, NET_LINE_MAX, "%c %llu %lu\n", '0' + e->pad,
+                            (unsigned long long)e->frame, (unsigned long)e->ms);
+        case NET_VELOCITY:
+            return snprintf(line, NET_LINE_MAX, "V %u %u\n", e->pad, e->value);
+        case NET_STEP:
+            return snprintf(line, NET_LINE_MAX, "STEP %lu %u %llu %lu\n", (unsigned long)e->index, e->pad,
+                            (unsigned long long)e->frame, (unsigned long)e->ms);
+        case NET_BEAT:
+            return snprintf(line, NET_LINE_MAX, "BEAT %lu %u %u %llu %lu\n", (unsigned long)e->index, e->value,
+                            e->sub, (unsigned long long)e->frame, (unsigned long)e->ms);
+        default:
+            return snprintf(line, NET_LINE_MAX, "SEQ end\n");
+    }
+}
+
+
+bool netBackedOff(const NET_CLIENT_T* c)
+{
+    return (int32_t)(millis() - c->backoffUntil) < 0;
+}
+
+
+void put16(uint8_t* p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+
+void put32(uint8_t* p, uint32_t v)
+{
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+
+// A binary batch starts with its header, filled in by netFlush(); the
+// first event's frame and ms are the anchor, written only once that event
+// is sure to go in the batch
+void netAppend(NET_CLIENT_T* c, const NET_EVENT_T* e, const char* line, int n)
+{
+    if (!c->connected) return;
+
+    bool anchor = c->binary && c->len == 0;
+    if (c->binary) n = NET_RECORD_LEN;
+    if (netBackedOff(c) || c->len + (anchor ? NET_HEADER_LEN : 0) + n > NET_BATCH_MAX)
+    {
+        portENTER_CRITICAL(&netStatsMux);
+        c->dropped++;
+        portEXIT_CRITICAL(&netStatsMux);
+        return;
+    }
+    if (anchor)
+    {
+        put32(&c->batch[4], (uint32_t)e->frame);
+        put32(&c->batch[8], e->ms);
+        c->len = NET_HEADER_LEN;
+    }
+
+    uint8_t* r = &c->batch[c->len];
+    if (c->binary)
+    {
+        r[0] = e->type;
+        r[1] = e->pad;
+        r[2] = e->value;
+        r[3] = e->sub;
+        put32(&r[4], e->index);
+        put32(&r[8], (uint32_t)e->frame);
+    }
+    else
+    {
+        memcpy(r, line, n);
+    }
+    c->len += n;
+}
+
+
+void netFlush(uint8_t num)
+{
+    NET_CLIENT_T* c = &netClients[num];
+
+    if (!c->connected || c->len == 0 || netBackedOff(c)) return;
+    if (c->binary)
+    {
+        c->batch[0] = NET_VERSION;
+        c->batch[1] = NET_MSG_EVENTS;
+        put16(&c->batch[2], (c->len - NET_HEADER_LEN) / NET_RECORD_LEN);
+    }
+
+    uint32_t start = micros();
+    if (c->binary) wsServer.sendBIN(num, c->batch, c->len);
+    else wsServer.sendTXT(num, (const char*)c->batch, c->len);
+    uint32_t us = micros() - start;
+
+    portENTER_CRITICAL(&netStatsMux);
+    c->bytes += c->len;
+    c->frames++;
+    if (us > c->sendUsMax) c->sendUsMax = us;
+    portEXIT_CRITICAL(&netStatsMux);
+    c->len = 0;
+    if (us < NET_SLOW_MS * 1000UL)
+    {
+        c->slow = 0;
+        return;
+    }
+    c->backoffUntil = millis() + NET_BACKOFF_MS;
+    if (++c->slow >= NET_SLOW_LIMIT)
+    {
+        wsServer.disconnect(num);
+        c->connected = false;
+    }
+}
+
+
+void netEvent(uint8_t num, WStype_t type, uint8_t* payload, size_t length)
+{
+    if (num >= NET_CLIENTS) return;
+
+    NET_CLIENT_T* c = &netClients[num];
+    switch (type)
+    {
+        case WStype_CONNECTED:
+            portENTER_CRITICAL(&netStatsMux);
+            memset(c, 0, sizeof(*c));
+            portEXIT_CRITICAL(&netStatsMux);
+            c->connected = true;
+            break;
+        case WStype_DISCONNECTED:
+            c->connected = false;
+            break;
+        case WStype_TEXT:
+            // a frame ends a line even without its newline
+            for (size_t i = 0; i < length; i++) netRxPut(payload[i]);
+            netRxPut('\n');
+            break;
+        case WStype_BIN:
+            if (length < 2 || payload[0] != NET_VERSION) break;
+            if (!c->binary)
+            {
+                c->binary = true;
+                c->len = 0;     // drop a half-built text batch
+            }
+            if (payload[1] == NET_MSG_PING && length == NET_PING_LEN)
+            {
+                uint8_t pong[NET_PONG_LEN];
+
+                memcpy(pong, payload, NET_PING_LEN);
+                pong[1] = NET_MSG_PONG;
+                put32(&pong[12], millis());
+                wsServer.sendBIN(num, pong, NET_PONG_LEN);
+                portENTER_CRITICAL(&netStatsMux);
+                c->pings++;
+                portEXIT_CRITICAL(&netStatsMux);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+
+void netTask(void* arg)
+{
+    char line[NET_LINE_MAX];
+    uint32_t lastFlush = 0;
+
+    WiFi.mode(WIFI_STA);
+    WiFi.setSleep(false);       // modem sleep holds frames back for up to a beacon interval
+    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    wsServer.onEvent(netEvent);
+
+    for (;;)
+    {
+        if (WiFi.status() == WL_CONNECTED)
+        {
+            if (!netStarted)
+            {
+                wsServer.begin();
+                netStarted = true;
+            }
+            wsServer.loop();
+        }
+
+        // drained with nobody connected too, so the ring never fills up
+        uint32_t head = __atomic_load_n(&netHead, __ATOMIC_ACQUIRE);
+        while (netTail != head)
+        {
+            NET_EVENT_T e = netQueue[netTail % NET_QUEUE_LEN];
+            int n = netFormat(&e, line);
+
+            __atomic_store_n(&netTail, netTail + 1, __ATOMIC_RELEASE);
+            for (int i = 0; i < NET_CLIENTS; i++) netAppend(&netClients[i], &e, line, n);
+        }
+
+        if (millis() - lastFlush >= NET_FRAME_MS)
+        {
+            lastFlush = millis();
+            for (int i = 0; i < NET_CLIENTS; i++) netFlush(i);
+        }
+        vTaskDelay(1);
+    }
+}
+
+
+void printNetStats()
+{
+    static unsigned long since = 0;
+    uint32_t windowMs = millis() - since;
+
+    since = millis();
+    if (!HUB_WIFI || windowMs == 0) return;
+
+    usbPrintf("NET %s queue %lu/%lu of %d dropped %lu\n",
+              netStarted ? WiFi.localIP().toString().c_str() : "offline",
+              (unsigned long)(netHead - __atomic_load_n(&netTail, __ATOMIC_ACQUIRE)),
+              (unsigned long)netDepthMax, NET_QUEUE_LEN, (unsigned long)netQueueDropped);
+    netDepthMax = 0;
+    netQueueDropped = 0;
+
+    for (int i = 0; i < NET_CLIENTS; i++)
+    {
+        NET_CLIENT_T* c = &netClients[i];
+
+        if (!c->connected) continue;
+
+        // netTask() keeps counting on core 0: take the window and restart it in one go
+        portENTER_CRITICAL(&netStatsMux);
+        uint32_t frames = c->frames, bytes = c->bytes, dropped = c->dropped;
+        uint32_t pings = c->pings, sendUsMax = c->sendUsMax;
+        c->frames = c->dropped = c->pings = c->bytes = c->sendUsMax = 0;
+        portEXIT_CRITICAL(&netStatsMux);
+
+        usbPrintf("NET client %d %s %lufps %luB/s dropped %lu pings %lu send_max %luus%s\n", i,
+                  c->binary ? "bin" : "text", (unsigned long)(frames * 1000 / windowMs),
+                  (unsigned long)(bytes * 1000 / windowMs), (unsigned long)dropped,
+                  (unsigned long)pings, (unsigned long)sendUsMax, netBackedOff(c) ? " backoff" : "");
+    }
+}
+
+
+void handleLinkByte(LINK_PARSER_T* p, uint8_t b)
+{
+    switch (p->state)
+    {
+        case LINK_PING_SEQ:
+            p->state = LINK_IDLE;
+            if (!p->port) return;
+            p->port->write(LINK_PONG);
+            p->port->write(b);
+            return;
+        case LINK_BURST_LEN:
+            p->burstLeft = b;
+            p->state = b ? LINK_BURST_DATA : LINK_IDLE;
+            return;
+        case LINK_BURST_DATA:
+            if (--p->burstLeft == 0) p->state = LINK_IDLE;
+            return;
+        case LINK_TRACE:
+            p->frame[p->frameLen++] = b;
+            if (p->frameLen == TRACE_FRAME_LEN)
+            {
+                usbWrite(p->frame, TRACE_FRAME_LEN);
+                p->state = LINK_IDLE;
+            }
+            return;
+        case LINK_STATS:
+            p->frame[p->frameLen++] = b;
+            if (p->frameLen == PROF_FRAME_LEN)
+            {
+                printStats(p->frame);
+                p->state = LINK_IDLE;
+            }
+            return;
+        case LINK_METRO:
+        case LINK_LOOP:
+        case LINK_SEQ:
+            if (b == '\n' || b == '\r' || p->frameLen == LINK_FRAME_MAX - 1)
+            {
+                p->frame[p->frameLen] = 0;
+                if (p->state == LINK_METRO) metroCommand((const char*)p->frame);
+                else if (p->state == LINK_LOOP) looperCommand((const char*)p->frame);
+                else seqCommand((const char*)p->frame);
+                p->state = LINK_IDLE;
+            }
+            else
+            {
+                p->frame[p->frameLen++] = b;
+            }
+            return;
+        case LINK_STREAM:
+            p->frame[p->frameLen++] = b;
+            if (p->frameLen == 2)
+            {
+                p->frameWant = streamFrameLen(b);
+            }
+            else if (p->frameLen == p->frameWant)
+            {
+                if (p->link < HUB_LINKS) decodeStream(p->link, p->frame, p->frameLen);
+                p->state = LINK_IDLE;
+            }
+            return;
+    }
+
+    if (p->pendingPad)
+    {
+        uint8_t pad = p->pendingPad;
+        p->pendingPad = 0;
+
+        if (b & 0x80)
+        {
+            setPadVelocity(pad, b & 0x7F);
+            return;
+        }
+        // velocity byte lost, handle b on its own
+    }
+
+    if (b == LINK_PING)
+    {
+        p->state = LINK_PING_SEQ;
+        return;
+    }
+    if (b == LINK_BURST)
+    {
+        p->state = LINK_BURST_LEN;
+        return;
+    }
+    if (b == TRACE_SYNC)
+    {
+        p->frame[0] = b;
+        p->frameLen = 1;
+        p->state = LINK_TRACE;
+        return;
+    }
+    if (b == PROF_SYNC)
+    {
+        p->frame[0] = b;
+        p->frameLen = 1;
+        p->state = LINK_STATS;
+        return;
+    }
+    if (b == STREAM_SYNC)
+    {
+        p->frame[0] = b;
+        p->frameLen = 1;
+        p->state = LINK_STREAM;
+        return;
+    }
+
+    if ((b & 0xF0) == HIT_VELOCITY_FLAG)
+    {
+        p->pendingPad = b & 0x0F;
+        return;
+    }
+
+    if (b > '0' && b < '0' + NUM_PADS)
+    {
+        triggerPad(b - '0');
+        return;
+    }
+
+    switch (b)
+    {
+        case BENCH_CMD:
+            if (p->link == HUB_LINKS) benchVoices();
+            break;
+        case METRO_CMD:
+        case LOOP_CMD:
+        case SEQ_CMD:
+            if (p->link == HUB_LINKS)
+            {
+                p->frameLen = 0;
+                p->state = (b == METRO_CMD) ? LINK_METRO : (b == LOOP_CMD) ? LINK_LOOP : LINK_SEQ;
+            }
+            break;
+        case TRACE_CMD_START:
+        case TRACE_CMD_STOP:
+        case PROF_CMD_STATS:
+        case ORIENT_CMD_ZERO:
+        case STREAM_CMD_START:
+        case STREAM_CMD_STOP:
+        case CALIB_CMD_RUN:
+        case CALIB_CMD_MORE:
+        case CALIB_CMD_LESS:
+            if (p->link == HUB_LINKS)
+            {
+                SerialBT.write(b);
+                HC05.write(b);
+                if (b == PROF_CMD_STATS)
+                {
+                    printHubStats();
+                    printStreamStats();
+                    printNetStats();
+                    printUsbStats();
+                }
+                if (b == ORIENT_CMD_ZERO)
+                {
+                    for (int i = 0; i < HUB_LINKS; i++) hubDetectors[i].zeroYaw = true;
+                }
+            }
+            break;
+    }
+}
+
+
+// Client text, parsed on the audio core between blocks
+void netReceive()
+{
+    uint32_t head = __atomic_load_n(&netRxHead, __ATOMIC_ACQUIRE);
+
+    while (netRxTail != head)
+    {
+        uint8_t b = netRx[netRxTail % NET_RX_LEN];
+
+        __atomic_store_n(&netRxTail, netRxTail + 1, __ATOMIC_RELEASE);
+        handleLinkByte(&netParser, b);
+    }
+}
+
+
+bool hc05Command(const char* cmd)
+{
+    while (HC05.available()) HC05.read();
+    HC05.print(cmd);
+    HC05.print("\r\n");
+    String reply = HC05.readStringUntil('\n');
+    return reply.startsWith("OK");
+}
+
+
+// Returns the rate the module answers AT on, 0 if none
+uint32_t hc05Probe()
+{
+    const uint32_t bauds[] = { LINK_FALLBACK_BAUD, LINK_BAUD, LINK_AT_BAUD };
+
+    for (int i = 0; i < 3; i++)
+    {
+        HC05.updateBaudRate(bauds[i]);
+        delay(10);
+        if (hc05Command("AT") || hc05Command("AT")) return bauds[i];
+    }
+    return 0;
+}
+
+
+bool hc05Program(uint32_t baud)
+{
+    char cmd[24];
+    snprintf(cmd, sizeof(cmd), "AT+UART=%lu,0,0", (unsigned long)baud);
+    if (!hc05Command(cmd)) return false;
+
+    // Settings apply after a restart; release KEY so it comes back in data mode
+    HC05.print("AT+RESET\r\n");
+    HC05.flush();
+    digitalWrite(HC05_KEY, LOW);
+    delay(1000);
+    return true;
+}
+
+
+// Same sequence as hc05_link_setup() on the nodes
+uint32_t setupHc05Link()
+{
+    pinMode(HC05_KEY, OUTPUT);
+    digitalWrite(HC05_KEY, HIGH);
+    delay(50);
+    HC05.setTimeout(300);
+
+    uint32_t current = hc05Probe();
+    if (current == 0)
+    {
+        digitalWrite(HC05_KEY, LOW);
+        HC05.updateBaudRate(LINK_FALLBACK_BAUD);
+        return LINK_FALLBACK_BAUD;
+    }
+
+    if (current != LINK_BAUD)
+    {
+        if (!hc05Program(LINK_BAUD))
+        {
+            digitalWrite(HC05_KEY, LOW);
+            return current;
+        }
+
+        digitalWrite(HC05_KEY, HIGH);
+        delay(50);
+        HC05.updateBaudRate(LINK_BAUD);
+        if (!hc05Command("AT") && !hc05Command("AT"))
+        {
+            current = hc05Probe();
+            if (current != 0 && current != LINK_FALLBACK_BAUD) hc05Program(LINK_FALLBACK_BAUD);
+            digitalWrite(HC05_KEY, LOW);
+            HC05.updateBaudRate(LINK_FALLBACK_BAUD);
+            return LINK_FALLBACK_BAUD;
+        }
+    }
+
+    digitalWrite(HC05_KEY, LOW);
+    delay(50);
+    while (HC05.available()) HC05.read();
+    return LINK_BAUD;
+}
+
+
+int16_t clip16(int32_t v)
+{
+    return v > 32767 ? 32767 : (v < -32768 ? -32768 : v);
+}
+
+
+// Voices are summed in 32 bits and clipped once per frame, a block at a time
+void IRAM_ATTR mixAudio()
+{
+    static int16_t block[MIX_BLOCK * 2];
+
+    for (int f = 0; f < MIX_BLOCK; f++)
+    {
+        int32_t left = 0;
+        int32_t right = 0;
+        int32_t sL, sR;
+
+        if (metro.on && (mixFrames << 16) >= metro.nextQ16) metroTick();
+        if (seq.on && mixFrames >= seq.nextFrame) seqTick();
+        looperFrame();
+        if (clickVoice.active)
+        {
+            if (renderVoice(&clickVoice, &sL, &sR))
+            {
+                left += (sL * clickVoice.gain) >> 8;
+                right += (sR * clickVoice.gain) >> 8;
+            }
+            else
+            {
+                clickVoice.active = false;
+            }
+        }
+
+        for (int i = 0; i < MAX_SOUNDS; i++)
+        {
+            PLAYBACK_T* v = &sounds[i];
+
+            if (!v->active) continue;
+            if (!renderVoice(v, &sL, &sR))
+            {
+                stopVoice(v);
+                continue;
+            }
+            left += (sL * v->gain) >> 8;
+            right += (sR * v->gain) >> 8;
+        }
+
+        block[2 * f] = clip16(left);
+        block[2 * f + 1] = clip16(right);
+        mixFrames++;
+    }
+
+    size_t bw;
+    i2s_write(I2S_NUM_0, block, sizeof(block), &bw, portMAX_DELAY);
+}
+
+
+void setup()
+{
+    Serial.begin(USB_BAUD);
+    HC05.begin(LINK_FALLBACK_BAUD, SERIAL_8N1, HC05_RX, HC05_TX);
+    Serial.print("HC-05 link at ");
+    Serial.println(setupHc05Link());
+
+    pinMode(BTN1, INPUT_PULLUP);
+    pinMode(BTN2, INPUT_PULLUP);
+    pinMode(BTN3, INPUT_PULLUP);
+
+
+    buildSineTable();
+    looperClear();
+    i2s_driver_install(I2S_NUM_0, &i2s_config, 0, NULL);
+    i2s_set_pin(I2S_NUM_0, &pin_config);
+    i2s_set_sample_rates(I2S_NUM_0, SAMPLE_RATE);
+
+
+    if (!SerialBT.begin("ESP32_MASTER", true)) {  
+        Serial.println("Failed to start BT in master mode");
+        while (1) { delay(1000); }
+    }
+    Serial.println("ESP32 Bluetooth started in master mode");
+
+
+    SerialBT.setPin("1234",4);
+
+
+    sampleQueue = xQueueCreate(HUB_QUEUE_LEN, sizeof(HUB_SAMPLE_T));
+    hitQueue = xQueueCreate(HUB_QUEUE_LEN, sizeof(HUB_HIT_T));
+    xTaskCreatePinnedToCore(hubDetectTask, "hubDetect", 4096, NULL, 2, NULL, 0);
+
+    bankLoad();
+    xTaskCreatePinnedToCore(prefetchTask, "prefetch", 4096, NULL, 3, &prefetchHandle, 0);
+
+    // core 1 is left to loop() and the mixer
+    if (HUB_WIFI) xTaskCreatePinnedToCore(netTask, "net", 4096, NULL, 1, NULL, 0);
+
+    if (SerialBT.connect(hc05Address)) {
+        Serial.println("Connected to HC-05!");
+        if (HUB_DETECT_BT) SerialBT.write(STREAM_CMD_START);
+    } else {
+        Serial.println("Failed to connect to HC-05");
+    }
+    if (HUB_DETECT_HC05) HC05.write(STREAM_CMD_START);
+}
+
+
+void loop()
+{
+
+    if (digitalRead(BTN1) == 0) playSound(snare);
+    if (digitalRead(BTN2) == 0) playSound(hihat);
+    if (digitalRead(BTN3) == 0) playSound(kick);
+
+    while (SerialBT.available())
+    {
+        handleLinkByte(&btParser, SerialBT.read());
+    }
+
+    while (HC05.available())
+    {
+        handleLinkByte(&hc05Parser, HC05.read());
+    }
+    while (Serial.available())
+    {
+        handleLinkByte(&usbParser, Serial.read());
+    }
+    netReceive();
+
+
+    static unsigned long lastTry = 0;
+    if (!SerialBT.connected() && millis() - lastTry > 5000)
+    {
+        lastTry = millis();
+        usbPrintf("Reconnecting to HC-05...\n");
+        if (SerialBT.connect(hc05Address) && HUB_DETECT_BT) SerialBT.write(STREAM_CMD_START);
+    }
+
+    HUB_HIT_T hit;
+    while (xQueueReceive(hitQueue, &hit, 0) == pdTRUE)
+    {
+        if (hit.velocity == 0) triggerPad(hit.pad);
+        else setPadVelocity(hit.pad, hit.velocity);
+    }
+
+    static unsigned long lastHubReport = 0;
+    if (millis() - lastHubReport >= HUB_REPORT_MS)
+    {
+        lastHubReport = millis();
+        printHubStats();
+        printNetStats();
     }
 
-    mixAudio(); 
+    mixAudio();
+    printBeats();
+    printSteps();
+    usbFlush();
 }
@@ -0,0 +1,187 @@
+#include <stdlib.h>
+#include <string.h>
+#include "eval.h"
+#include "mock_hal.h"
+#include "roles.h"
+#include "calib.h"
+
+const eval_role_t eval_roles[] = {
+    { "right_hand", "RIGHT_HAND", ROLE_RIGHT_HAND },
+    { "left_hand",  "LEFT_HAND",  ROLE_LEFT_HAND },
+    { "kick_pedal", "KICK_PEDAL", ROLE_KICK_PEDAL },
+    { "final",      "FINAL_KICK", ROLE_FINAL_KICK },
+    { "hihat_foot", "HIHAT_FOOT", ROLE_HIHAT_FOOT },
+};
+
+const unsigned eval_role_count = sizeof(eval_roles) / sizeof(eval_roles[0]);
+
+const strike_role_t *eval_find_role(const char *name)
+{
+    const eval_role_t *r = eval_find(name);
+
+    return r ? &r->role : NULL;
+}
+
+const eval_role_t *eval_find(const char *name)
+{
+    for (unsigned i = 0; i < eval_role_count; i++)
+        if (strcmp(eval_roles[i].name, name) == 0)
+            return &eval_roles[i];
+    return NULL;
+}
+
+void eval_clear(eval_result_t *r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+typedef struct {
+    const uint32_t *t;
+    size_t n;
+    size_t next;                // first label a later hit can still score
+    uint8_t *matched;
+    uint32_t window_us;
+    eval_result_t *r;
+} matcher_t;
+
+static void score_hit(matcher_t *m, uint32_t t_hit)
+{
+    size_t i;
+    int32_t latency;
+
+    m->r->detections++;
+
+    while (m->next < m->n && m->t[m->next] + m->window_us < t_hit)
+        m->next++;
+
+    i = m->next;
+    if (i >= m->n || t_hit + EVAL_EARLY_US < m->t[i])
+    {
+        m->r->false_hits++;
+        return;
+    }
+    if (m->matched[i] && i + 1 < m->n && t_hit + EVAL_EARLY_US >= m->t[i + 1])
+        i++;
+    if (m->matched[i])
+    {
+        m->r->doubles++;
+        return;
+    }
+
+    m->matched[i] = 1;
+    m->r->hits++;
+    latency = (int32_t)(t_hit - m->t[i]);
+    m->r->latency_sum_us += latency;
+    if (latency > m->r->latency_max_us)
+        m->r->latency_max_us = latency;
+    if (latency < 0)
+        latency = 0;
+    m->r->latency_hist[latency / 1000 < EVAL_HIST_BINS ? latency / 1000 : EVAL_HIST_BINS - 1]++;
+}
+
+int eval_trace(const strike_role_t *role, const trace_t *tr, uint32_t window_us,
+               int use_hub_hits, eval_result_t *r)
+{
+    imu_t imu;
+    calib_t cal;
+    int16_t rest[3], noise[3];
+    strike_t strike;
+    matcher_t m;
+    uint8_t bytes[16];
+    uint8_t velocity_next = 0;
+    const uint32_t *labels = use_hub_hits ? tr->hub_hits : tr->labels;
+    size_t n_labels = use_hub_hits ? tr->n_hub_hits : tr->n_labels;
+
+    mock_attach(tr);
+    imu_open(&imu, IMU_ADDR_HIGH);
+    if (calib_boot(&cal, &imu, role->det.noise_mult, rest, noise) < 0)
+        return -1;
+    strike_init(&strike, role, &imu, &cal, rest, noise);
+
+    /* labels during calibration are not scored */
+    memset(&m, 0, sizeof(m));
+    m.t = labels;
+    m.n = n_labels;
+    while (m.next < m.n && m.t[m.next] < mock_now_us())
+        m.next++;
+    m.t += m.next;
+    m.n -= m.next;
+    m.next = 0;
+    m.window_us = window_us;
+    m.r = r;
+    m.matched = calloc(m.n ? m.n : 1, 1);
+    if (!m.matched)
+        return -1;
+    r->labels += m.n;
+
+    while (!mock_done())
+    {
+        size_t n;
+
+        strike_poll(&strike);
+
+        n = mock_uart_take(bytes, sizeof(bytes));
+        for (size_t i = 0; i < n; i++)
+        {
+            if (velocity_next)
+                velocity_next = 0;
+            else if ((bytes[i] & 0xF0) == HIT_VELOCITY_FLAG)
+                velocity_next = 1;
+            else if (bytes[i] == (uint8_t)role->pad)
+                score_hit(&m, mock_now_us());
+        }
+
+        mock_delay_us(role->sample_period_ms * 1000UL);
+    }
+
+    free(m.matched);
+    return 0;
+}
+
+void eval_merge(eval_result_t *into, const eval_result_t *r)
+{
+    into->labels += r->labels;
+    into->detections += r->detections;
+    into->hits += r->hits;
+    into->false_hits += r->false_hits;
+    into->doubles += r->doubles;
+    into->latency_sum_us += r->latency_sum_us;
+    if (r->latency_max_us > into->latency_max_us)
+        into->latency_max_us = r->latency_max_us;
+    for (unsigned i = 0; i < EVAL_HIST_BINS; i++)
+        into->latency_hist[i] += r->latency_hist[i];
+}
+
+double eval_precision(const eval_result_t *r)
+{
+    return r->detections ? (double)r->hits / (r->hits + r->false_hits) : 0.0;
+}
+
+double eval_recall(const eval_result_t *r)
+{
+    return r->labels ? (double)r->hits / r->labels : 0.0;
+}
+
+double eval_double_rate(const eval_result_t *r)
+{
+    return r->hits ? (double)r->doubles / r->hits : 0.0;
+}
+
+double eval_latency_mean_ms(const eval_result_t *r)
+{
+    return r->hits ? r->latency_sum_us / 1000.0 / r->hits : 0.0;
+}
+
+unsigned eval_latency_pct_ms(const eval_result_t *r, unsigned pct)
+{
+    uint64_t need = ((uint64_t)r->hits * pct + 99) / 100;
+    uint64_t seen = 0;
+
+    for (unsigned i = 0; i < EVAL_HIST_BINS; i++)
+    {
+        seen += r->latency_hist[i];
+        if (seen >= need && seen)
+            return i;
+    }
+    return 0;
+}
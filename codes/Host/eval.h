@@ -0,0 +1,63 @@
+#ifndef EVAL_H
+#define EVAL_H
+
+#include <stdint.h>
+#include "strike.h"
+#include "trace_file.h"
+
+/*
+ * Replay a trace through the node detection pipeline (strike.c, calib.c and
+ * hit.c on the host mocks) and score the hits it sends against the labelled
+ * onsets.
+ *
+ * The node calibrates on the start of the trace exactly as at boot, so a
+ * trace should open with ~1.3 s of the node at rest; labels inside that
+ * stretch are not scored. A hit counts for a label from EVAL_EARLY_US
+ * before it up to window_us after it. Further hits for a label already hit
+ * are double triggers, anything else is a false hit.
+ */
+
+#define EVAL_EARLY_US       20000
+#define EVAL_HIST_BINS      256     // 1 ms latency bins, the last one collects the rest
+
+typedef struct {
+    const char *name;
+    const char *prefix;         // of the role's constants in roles.h
+    strike_role_t role;
+} eval_role_t;
+
+extern const eval_role_t eval_roles[];
+extern const unsigned eval_role_count;
+
+typedef struct {
+    uint32_t labels;
+    uint32_t detections;
+    uint32_t hits;              // labels hit at least once
+    uint32_t false_hits;
+    uint32_t doubles;
+    int64_t  latency_sum_us;    // over hits, from the label to the hit
+    int32_t  latency_max_us;
+    uint32_t latency_hist[EVAL_HIST_BINS];
+} eval_result_t;
+
+const strike_role_t *eval_find_role(const char *name);
+
+const eval_role_t *eval_find(const char *name);
+
+void eval_clear(eval_result_t *r);
+
+/* use_hub_hits scores against the 'h' records instead of the labels */
+int eval_trace(const strike_role_t *role, const trace_t *tr, uint32_t window_us,
+               int use_hub_hits, eval_result_t *r);
+
+void eval_merge(eval_result_t *into, const eval_result_t *r);
+
+double eval_precision(const eval_result_t *r);
+double eval_recall(const eval_result_t *r);
+double eval_double_rate(const eval_result_t *r);
+double eval_latency_mean_ms(const eval_result_t *r);
+
+/* Latency in ms that pct percent of the hits are at or under */
+unsigned eval_latency_pct_ms(const eval_result_t *r, unsigned pct);
+
+#endif /* EVAL_H */
@@ -0,0 +1,21 @@
+#ifndef MOCK_AVR_EEPROM_H
+#define MOCK_AVR_EEPROM_H
+
+/*
+ * Host stand-in for <avr/eeprom.h>. EEMEM variables become thread-local
+ * host variables and read back erased (0xFF) until written after the last
+ * mock_attach(), so every replay starts from a blank EEPROM.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define EEMEM _Thread_local
+
+/* "static calib_record_t EEMEM x" puts the storage class after the type */
+#pragma GCC diagnostic ignored "-Wold-style-declaration"
+
+void eeprom_read_block(void *dst, const void *src, size_t n);
+void eeprom_update_block(const void *src, void *dst, size_t n);
+
+#endif /* MOCK_AVR_EEPROM_H */
@@ -0,0 +1,181 @@
+#include <string.h>
+#include "mock_hal.h"
+#include "avr/eeprom.h"
+#include "imu.h"
+#include "uart.h"
+
+#define MOCK_UART_LOG   64
+
+static _Thread_local const trace_t *trace;
+static _Thread_local size_t cursor;
+static _Thread_local size_t last_read;         // index of the last sample read, + 1
+static _Thread_local uint32_t now_us;
+static _Thread_local uint8_t eeprom_written;
+static _Thread_local uint8_t uart_log[MOCK_UART_LOG];
+static _Thread_local size_t uart_len;
+
+void mock_attach(const trace_t *tr)
+{
+    trace = tr;
+    cursor = 0;
+    last_read = 0;
+    now_us = tr->n_samples ? tr->samples[0].t_us : 0;
+    eeprom_written = 0;
+    uart_len = 0;
+}
+
+uint32_t mock_now_us(void)
+{
+    return now_us;
+}
+
+void mock_delay_us(uint32_t us)
+{
+    now_us += us;
+}
+
+int mock_done(void)
+{
+    return trace->n_samples == 0 || now_us > trace->samples[trace->n_samples - 1].t_us;
+}
+
+size_t mock_uart_take(uint8_t *buf, size_t max)
+{
+    size_t n = uart_len < max ? uart_len : max;
+
+    memcpy(buf, uart_log, n);
+    memmove(uart_log, uart_log + n, uart_len - n);
+    uart_len -= n;
+    return n;
+}
+
+/* Latest sample at or before the clock */
+static const trace_sample_t *current_sample(void)
+{
+    if (trace->n_samples == 0)
+        return NULL;
+
+    while (cursor + 1 < trace->n_samples && trace->samples[cursor + 1].t_us <= now_us)
+        cursor++;
+
+    return &trace->samples[cursor];
+}
+
+/* Latest sample, marked as read for imu_new_data() */
+static const trace_sample_t *read_sample(void)
+{
+    const trace_sample_t *s = current_sample();
+
+    if (s)
+        last_read = cursor + 1;
+    return s;
+}
+
+/* imu.h: every device reads the same trace */
+
+int imu_open(imu_t *imu, uint8_t addr7)
+{
+    imu->addr = addr7;
+    imu->acc_odr = IMU_ODR_104HZ;
+    imu->gyro_odr = IMU_ODR_OFF;
+    return 0;
+}
+
+/* Like the data-ready flag, cleared by a read until the next sample is due */
+int imu_new_data(const imu_t *imu)
+{
+    (void)imu;
+    return current_sample() != NULL && cursor + 1 != last_read;
+}
+
+int imu_set_rate(imu_t *imu, uint8_t acc_odr, uint8_t gyro_odr)
+{
+    imu->acc_odr = acc_odr;
+    imu->gyro_odr = gyro_odr;
+    return 0;
+}
+
+int imu_read_acc(const imu_t *imu, int16_t acc[3])
+{
+    const trace_sample_t *s = read_sample();
+
+    (void)imu;
+    if (!s)
+        return -1;
+
+    memcpy(acc, s->acc, sizeof(s->acc));
+    return 0;
+}
+
+int imu_read_acc_bytes(const imu_t *imu, uint8_t buf[6])
+{
+    int16_t acc[3];
+
+    if (imu_read_acc(imu, acc) < 0)
+        return -1;
+
+    for (int i = 0; i < 3; i++)
+    {
+        buf[2 * i] = (uint8_t)acc[i];
+        buf[2 * i + 1] = (uint8_t)((uint16_t)acc[i] >> 8);
+    }
+    return 0;
+}
+
+int imu_read_acc_gyro(const imu_t *imu, int16_t acc[3], int16_t gyro[3])
+{
+    const trace_sample_t *s = read_sample();
+
+    (void)imu;
+    if (!s)
+        return -1;
+
+    memcpy(acc, s->acc, sizeof(s->acc));
+    memcpy(gyro, s->gyro, sizeof(s->gyro));
+    return 0;
+}
+
+int imu_read_acc_pair(const imu_t *a, const imu_t *b, int16_t acc_a[3], int16_t acc_b[3])
+{
+    int ra = imu_read_acc(a, acc_a);
+    int rb = imu_read_acc(b, acc_b);
+
+    return (ra < 0 || rb < 0) ? -1 : 0;
+}
+
+/* uart.h */
+
+int uart_send(char data, FILE *stream)
+{
+    (void)stream;
+
+    if (uart_len < MOCK_UART_LOG)
+        uart_log[uart_len++] = (uint8_t)data;
+    return 0;
+}
+
+int uart_try_send(char data)
+{
+    return uart_send(data, NULL);
+}
+
+int uart_try_receive(void)
+{
+    return -1;
+}
+
+/* avr/eeprom.h */
+
+void eeprom_read_block(void *dst, const void *src, size_t n)
+{
+    if (eeprom_written)
+        memcpy(dst, src, n);
+    else
+        memset(dst, 0xFF, n);
+}
+
+void eeprom_update_block(const void *src, void *dst, size_t n)
+{
+    memcpy(dst, src, n);
+    eeprom_written = 1;
+}
@@ -0,0 +1,35 @@
+#ifndef MOCK_HAL_H
+#define MOCK_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "trace_file.h"
+
+/*
+ * Host mocks of the node hardware interfaces, enough to run strike.c,
+ * calib.c and hit.c unchanged:
+ *
+ *   imu.h    imu_read_acc() and friends return the trace sample that is
+ *            current at the mock clock, like the sensor's output registers,
+ *            for every device
+ *   uart.h   uart_send() appends to a byte log read with mock_uart_take()
+ *   delays   _delay_ms() / _delay_us() advance the mock clock
+ *   EEPROM   blank at every mock_attach()
+ *
+ * All state is thread-local so independent replays can run in parallel.
+ */
+
+/* Start a replay of tr: clock at its first sample, blank EEPROM, empty log */
+void mock_attach(const trace_t *tr);
+
+uint32_t mock_now_us(void);
+
+void mock_delay_us(uint32_t us);
+
+/* 1 once the clock has passed the last sample */
+int mock_done(void);
+
+/* Move up to max bytes sent since the last call into buf, returns the count */
+size_t mock_uart_take(uint8_t *buf, size_t max);
+
+#endif /* MOCK_HAL_H */
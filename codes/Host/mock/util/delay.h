@@ -0,0 +1,11 @@
+#ifndef MOCK_UTIL_DELAY_H
+#define MOCK_UTIL_DELAY_H
+
+/* Host stand-in for <util/delay.h>: delays advance the mock clock instead */
+
+#include "mock_hal.h"
+
+#define _delay_ms(ms)   mock_delay_us((uint32_t)((ms) * 1000))
+#define _delay_us(us)   mock_delay_us((uint32_t)(us))
+
+#endif /* MOCK_UTIL_DELAY_H */
@@ -0,0 +1,149 @@
+/*
+ * Compare onset vs peak trigger latency of the node strike detection on
+ * recorded or synthetic traces.
+ *
+ * Runs the role's full pipeline (strike.c, detector.c, gravity.c, calib.c)
+ * on the mocks in mock/, sampled at the role's period like replay does. For
+ * every strike it reports when the onset event fired (what the nodes send)
+ * and when the peak event fired (what a peak-only detector would have
+ * sent), and the time saved between them.
+ *
+ * Build: make onset_latency
+ * Usage: onset_latency [-r role] [-v] trace...
+ *   -r  right_hand (default), left_hand, kick_pedal, final or hihat_foot
+ *   -v  print a line per strike
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "eval.h"
+#include "mock_hal.h"
+#include "trace_file.h"
+#include "calib.h"
+
+typedef struct {
+    unsigned long strikes;
+    unsigned long early;        // onset event before the peak event
+    unsigned long weak;         // onsets whose peak stayed under the trigger
+    uint64_t lead_sum_us;
+    uint32_t lead_max_us;
+} onset_stats_t;
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: onset_latency [-r role] [-v] trace...\n");
+    exit(2);
+}
+
+static int run_trace(const strike_role_t *role, const trace_t *tr, const char *name,
+                     int verbose, onset_stats_t *st)
+{
+    imu_t imu;
+    calib_t cal;
+    int16_t rest[3], noise[3];
+    strike_t strike;
+    uint8_t bytes[16];
+    uint32_t t0, onset_us = 0;
+
+    mock_attach(tr);
+    t0 = mock_now_us();
+    imu_open(&imu, IMU_ADDR_HIGH);
+    if (calib_boot(&cal, &imu, role->det.noise_mult, rest, noise) < 0)
+        return -1;
+    strike_init(&strike, role, &imu, &cal, rest, noise);
+
+    while (!mock_done())
+    {
+        uint8_t ev = strike_poll(&strike);
+        uint32_t now = mock_now_us();
+
+        if (ev & DET_EVENT_ONSET)
+            onset_us = now;
+
+        if (ev & DET_EVENT_PEAK)
+        {
+            uint32_t lead = now - onset_us;
+            int weak = strike.amplitude <= strike.det.trigger;
+
+            st->strikes++;
+            if (lead > 0)
+                st->early++;
+            if (weak)
+                st->weak++;
+            st->lead_sum_us += lead;
+            if (lead > st->lead_max_us)
+                st->lead_max_us = lead;
+
+            if (verbose)
+                printf("%-24s %10.1f %10.1f %8.1f %9u%s\n", name,
+                       (onset_us - t0) / 1000.0, (now - t0) / 1000.0, lead / 1000.0,
+                       detector_velocity(strike.amplitude), weak ? "  weak" : "");
+        }
+
+        /* the hit bytes are not needed, only keep the mock's log from filling */
+        while (mock_uart_take(bytes, sizeof(bytes)))
+            ;
+
+        mock_delay_us(role->sample_period_ms * 1000UL);
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const strike_role_t *role = &eval_roles[0].role;
+    onset_stats_t st = {0};
+    int verbose = 0, failed = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:v")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r':
+                role = eval_find_role(optarg);
+                if (!role)
+                {
+                    fprintf(stderr, "unknown role %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'v': verbose = 1; break;
+            default: usage();
+        }
+    }
+    if (optind >= argc)
+        usage();
+
+    if (verbose)
+        printf("%-24s %10s %10s %8s %9s\n", "trace", "onset_ms", "peak_ms", "lead_ms", "velocity");
+
+    for (int i = optind; i < argc; i++)
+    {
+        trace_t tr;
+
+        if (trace_load(argv[i], &tr) < 0)
+        {
+            failed++;
+            continue;
+        }
+        if (run_trace(role, &tr, argv[i], verbose, &st) < 0)
+        {
+            fprintf(stderr, "%s: replay failed\n", argv[i]);
+            failed++;
+        }
+        trace_free(&tr);
+    }
+
+    printf("%lu strikes, sampled every %u ms\n", st.strikes, role->sample_period_ms);
+    if (st.strikes)
+    {
+        printf("onset before peak event: %lu (%.0f%%)\n", st.early, 100.0 * st.early / st.strikes);
+        printf("mean lead: %.1f ms, max lead: %.1f ms\n",
+               st.lead_sum_us / 1000.0 / st.strikes, st.lead_max_us / 1000.0);
+        printf("onsets whose peak stayed under the trigger: %lu\n", st.weak);
+    }
+
+    return failed ? 1 : 0;
+}
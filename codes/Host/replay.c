@@ -0,0 +1,107 @@
+/*
+ * Replay recorded or synthetic traces through the node detection code and
+ * score it against the labelled strike onsets.
+ *
+ * Runs strike.c, detector.c, gravity.c, calib.c and hit.c as built for the
+ * nodes, on the mocks in mock/, sampling the trace at the role's sample
+ * period the way the node's detect task reads the IMU.
+ *
+ * Build: make replay
+ * Usage: replay [-r role] [-w window_ms] [-H] [-v] trace...
+ *   -r  right_hand (default), left_hand, kick_pedal, final or hihat_foot
+ *   -w  latest a hit may come after its onset, default 60 ms
+ *   -H  score against the hits the hub played ('h' records) instead of the
+ *       labels, to compare a detector change with the recorded firmware
+ *   -v  print a line per trace
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "eval.h"
+#include "trace_file.h"
+
+static void print_result(const char *name, const eval_result_t *r)
+{
+    printf("%-24s labels %5u  hits %5u  false %4u  double %4u  "
+           "precision %.3f  recall %.3f  double %.3f  "
+           "latency mean %.1f p95 %u max %.1f ms\n",
+           name, r->labels, r->hits, r->false_hits, r->doubles,
+           eval_precision(r), eval_recall(r), eval_double_rate(r),
+           eval_latency_mean_ms(r), eval_latency_pct_ms(r, 95),
+           r->latency_max_us / 1000.0);
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: replay [-r role] [-w window_ms] [-H] [-v] trace...\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const strike_role_t *role = &eval_roles[0].role;
+    uint32_t window_us = 60000;
+    int use_hub_hits = 0, verbose = 0, failed = 0;
+    eval_result_t total;
+    struct timespec t0, t1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:w:Hv")) != -1)
+    {
+        switch (opt)
+        {
+            case 'r':
+                role = eval_find_role(optarg);
+                if (!role)
+                {
+                    fprintf(stderr, "unknown role %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'w': window_us = (uint32_t)(atof(optarg) * 1000); break;
+            case 'H': use_hub_hits = 1; break;
+            case 'v': verbose = 1; break;
+            default: usage();
+        }
+    }
+    if (optind >= argc)
+        usage();
+
+    eval_clear(&total);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    for (int i = optind; i < argc; i++)
+    {
+        trace_t tr;
+        eval_result_t r;
+
+        if (trace_load(argv[i], &tr) < 0)
+        {
+            failed++;
+            continue;
+        }
+
+        eval_clear(&r);
+        if (eval_trace(role, &tr, window_us, use_hub_hits, &r) < 0)
+        {
+            fprintf(stderr, "%s: replay failed\n", argv[i]);
+            failed++;
+        }
+        else
+        {
+            if (verbose)
+                print_result(argv[i], &r);
+            eval_merge(&total, &r);
+        }
+        trace_free(&tr);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    print_result("total", &total);
+    printf("%d traces in %.2f s\n", argc - optind - failed,
+           (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * Generate a labelled synthetic drum trace v1 (see trace_file.h).
+ *
+ * The node rests for the first 2 s with gravity along one axis, then strikes
+ * follow at random intervals: a slow swing into the strike direction, then a
+ * decaying impact ringing on the swing axis. Each impact's first sample is
+ * written as an 'l' label.
+ *
+ * Build: make synth_trace
+ * Usage: synth_trace [-a +x|-x|+y|-y|+z|-z] [-g gravity_axis] [-n strikes]
+ *                    [-r rate_hz] [-m min_g] [-M max_g] [-N noise_g] [-s seed] > out.trace
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LSB_PER_G       4096
+#define REST_S          2.0
+#define SWING_S         0.08        // swing lead-in before the impact
+#define RING_HZ         35.0
+#define RING_TAU_S      0.012
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: synth_trace [-a axis] [-g gravity_axis] [-n strikes] "
+                    "[-r rate_hz] [-m min_g] [-M max_g] [-N noise_g] [-s seed]\n");
+    exit(2);
+}
+
+static int parse_axis(const char *s, int *axis, int *sign)
+{
+    if (strlen(s) != 2 || (s[0] != '+' && s[0] != '-') || s[1] < 'x' || s[1] > 'z')
+        return -1;
+    *sign = (s[0] == '-') ? -1 : 1;
+    *axis = s[1] - 'x';
+    return 0;
+}
+
+static double uniform(double lo, double hi)
+{
+    return lo + (hi - lo) * rand() / (double)RAND_MAX;
+}
+
+static double gauss(void)
+{
+    double u = uniform(1e-9, 1.0), v = uniform(0.0, 1.0);
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+int main(int argc, char **argv)
+{
+    int axis = 1, sign = -1, g_axis = 2, g_sign = 1;
+    int strikes = 50;
+    double rate = 208.0, min_g = 2.0, max_g = 6.0, noise_g = 0.02;
+    double t_strike, t_end, period;
+    unsigned seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "a:g:n:r:m:M:N:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'a':
+                if (parse_axis(optarg, &axis, &sign) < 0) return 2;
+                break;
+            case 'g':
+                if (parse_axis(optarg, &g_axis, &g_sign) < 0) return 2;
+                break;
+            case 'n':
+                strikes = atoi(optarg);
+                if (strikes <= 0) usage();
+                break;
+            case 'r':
+                rate = atof(optarg);
+                if (rate <= 0.0) usage();
+                break;
+            case 'm': min_g = atof(optarg); break;
+            case 'M': max_g = atof(optarg); break;
+            case 'N': noise_g = atof(optarg); break;
+            case 's': seed = (unsigned)strtoul(optarg, NULL, 0); break;
+            default:
+                usage();
+        }
+    }
+
+    srand(seed);
+    period = 1.0 / rate;
+
+    printf("# drum trace v1\n");
+    printf("# acc_lsb_per_g %d\n", LSB_PER_G);
+    printf("# gyro_mdps_per_lsb 70\n");
+    printf("# odr_hz %.0f\n", rate);
+    printf("# synthetic: seed %u, %d strikes %.1f-%.1f g on %c%c\n",
+           seed, strikes, min_g, max_g, sign < 0 ? '-' : '+', 'x' + axis);
+
+    t_strike = REST_S + uniform(0.2, 0.6);
+    t_end = t_strike;
+    double amp = uniform(min_g, max_g);
+    int done = 0, labelled = 0;
+    unsigned long seq = 0;
+
+    for (double t = 0.0; done < strikes || t < t_end + 0.5; t += period, seq++)
+    {
+        double a[3] = {0.0, 0.0, 0.0};
+        double dt = t - t_strike;
+
+        a[g_axis] += g_sign;
+        if (done < strikes)
+        {
+            if (dt >= -SWING_S && dt < 0.0)
+                a[axis] += sign * 0.4 * amp / max_g * sin(M_PI * (dt + SWING_S) / SWING_S);
+            if (dt >= 0.0)
+            {
+                if (!labelled)
+                {
+                    printf("l %lu\n", (unsigned long)(t * 1e6));
+                    labelled = 1;
+                }
+                a[axis] += sign * amp * exp(-dt / RING_TAU_S) * cos(2.0 * M_PI * RING_HZ * dt);
+            }
+            if (dt > 8 * RING_TAU_S)
+            {
+                done++;
+                t_end = t;
+                t_strike = t + uniform(0.25, 0.8);
+                amp = uniform(min_g, max_g);
+                labelled = 0;
+            }
+        }
+
+        printf("s %lu %lu", seq, (unsigned long)(t * 1e6));
+        for (int i = 0; i < 3; i++)
+            printf(" %d", (int)lround((a[i] + noise_g * gauss()) * LSB_PER_G));
+        printf(" 0 0 0\n");
+    }
+
+    return 0;
+}
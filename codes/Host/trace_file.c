@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trace_file.h"
+
+static int push(void **arr, size_t *n, size_t *cap, size_t size, const void *item)
+{
+    if (*n == *cap)
+    {
+        size_t grow = *cap ? *cap * 2 : 256;
+        void *p = realloc(*arr, grow * size);
+        if (!p)
+            return -1;
+        *arr = p;
+        *cap = grow;
+    }
+    memcpy((char *)*arr + *n * size, item, size);
+    (*n)++;
+    return 0;
+}
+
+int trace_load(const char *path, trace_t *tr)
+{
+    char line[256];
+    size_t cap_s = 0, cap_l = 0, cap_h = 0;
+    unsigned lineno = 0;
+    FILE *f = fopen(path, "r");
+
+    memset(tr, 0, sizeof(*tr));
+    if (!f)
+    {
+        perror(path);
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), f))
+    {
+        trace_sample_t s;
+        unsigned long seq, t;
+        int v[6];
+        int ok = 0;
+
+        lineno++;
+        switch (line[0])
+        {
+            case 's':
+                if (sscanf(line + 1, "%lu %lu %d %d %d %d %d %d", &seq, &t,
+                           &v[0], &v[1], &v[2], &v[3], &v[4], &v[5]) == 8)
+                {
+                    s.t_us = (uint32_t)t;
+                    for (int i = 0; i < 3; i++)
+                    {
+                        s.acc[i] = (int16_t)v[i];
+                        s.gyro[i] = (int16_t)v[i + 3];
+                    }
+                    ok = push((void **)&tr->samples, &tr->n_samples, &cap_s, sizeof(s), &s) == 0;
+                }
+                break;
+            case 'l':
+            case 'h':
+                if (sscanf(line + 1, "%lu", &t) == 1)
+                {
+                    uint32_t t32 = (uint32_t)t;
+                    if (line[0] == 'l')
+                        ok = push((void **)&tr->labels, &tr->n_labels, &cap_l, sizeof(t32), &t32) == 0;
+                    else
+                        ok = push((void **)&tr->hub_hits, &tr->n_hub_hits, &cap_h, sizeof(t32), &t32) == 0;
+                }
+                break;
+            case '#':
+            case '\n':
+            case '\r':
+            case '\0':
+                ok = 1;
+                break;
+        }
+
+        if (!ok)
+        {
+            fprintf(stderr, "%s:%u: bad record\n", path, lineno);
+            fclose(f);
+            trace_free(tr);
+            return -1;
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+void trace_free(trace_t *tr)
+{
+    free(tr->samples);
+    free(tr->labels);
+    free(tr->hub_hits);
+    memset(tr, 0, sizeof(*tr));
+}
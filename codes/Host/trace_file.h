@@ -0,0 +1,38 @@
+#ifndef TRACE_FILE_H
+#define TRACE_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Reader for drum trace v1 files as written by
+ * codes/Python/trace_capture.py and synth_trace:
+ *
+ *   s <seq> <t_us> <ax> <ay> <az> <gx> <gy> <gz>   sensor sample, raw counts
+ *   h <t_us> <pad>                                 hit the hub played
+ *   l <t_us> [pad]                                 labelled strike onset
+ *
+ * '#' starts a comment. Records must be in time order.
+ */
+
+typedef struct {
+    uint32_t t_us;
+    int16_t acc[3];
+    int16_t gyro[3];
+} trace_sample_t;
+
+typedef struct {
+    trace_sample_t *samples;
+    size_t n_samples;
+    uint32_t *labels;           // 'l' onset times
+    size_t n_labels;
+    uint32_t *hub_hits;         // 'h' hit times
+    size_t n_hub_hits;
+} trace_t;
+
+/* Returns 0, or -1 with a message on stderr */
+int trace_load(const char *path, trace_t *tr);
+
+void trace_free(trace_t *tr);
+
+#endif /* TRACE_FILE_H */
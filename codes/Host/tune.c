@@ -0,0 +1,323 @@
+/*
+ * Grid-search the detector constants of each node role over labelled
+ * traces, on all cores, and write the best ones as roles_tuned.h.
+ *
+ * Every candidate is scored with the same replay as the replay tool (see
+ * eval.h). Accuracy is the F1 score with double triggers counted as false
+ * hits; latency is the mean from labelled onset to hit. For each role the
+ * candidates nobody beats on both (the Pareto front) are printed, and the
+ * fastest one within TUNE_ACCURACY_SLACK of the most accurate is chosen.
+ *
+ * Build: make tune
+ * Usage: tune [-j threads] [-w window_ms] [-o roles_tuned.h]
+ *             -r role trace... [-r role trace...]
+ *
+ * Copy the header next to roles.h and build the nodes with -DROLES_TUNED.
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "eval.h"
+#include "imu.h"
+#include "trace_file.h"
+
+#define TUNE_MAX_ROLES          5
+#define TUNE_ACCURACY_SLACK     0.01
+
+/* Search grid; hold-off is in ms and converted with the role's sample period */
+static const float floor_g[] = { 0.5f, 0.75f, 1.0f, 1.25f, 1.5f, 1.75f, 2.0f, 2.5f, 3.0f };
+static const uint8_t noise_mult[] = { 8, 12, 16, 20, 24, 32, 40, 48 };
+static const uint16_t holdoff_ms[] = { 20, 40, 60, 80, 100, 140 };
+static const float slope_g[] = { 0.0f, 0.2f, 0.3f, 0.5f, 0.75f, 1.0f };
+
+#define N_FLOOR     (sizeof(floor_g) / sizeof(floor_g[0]))
+#define N_MULT      (sizeof(noise_mult) / sizeof(noise_mult[0]))
+#define N_HOLDOFF   (sizeof(holdoff_ms) / sizeof(holdoff_ms[0]))
+#define N_SLOPE     (sizeof(slope_g) / sizeof(slope_g[0]))
+#define N_GRID      (N_FLOOR * N_MULT * N_HOLDOFF * N_SLOPE)
+
+typedef struct {
+    strike_role_t role;
+    float floor_g;
+    float slope_g;
+    double accuracy;
+    double latency_ms;
+    double precision;
+    double recall;
+    double double_rate;
+    int pareto;
+} candidate_t;
+
+typedef struct {
+    const eval_role_t *base;
+    trace_t *traces;
+    int n_traces;
+    candidate_t *cand;
+    unsigned n_cand;
+    unsigned next;              // next candidate to score, under lock
+    const candidate_t *best;
+} role_job_t;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static role_job_t jobs[TUNE_MAX_ROLES];
+static int n_jobs;
+static uint32_t window_us = 60000;
+
+static double accuracy(const eval_result_t *r)
+{
+    uint32_t wrong = r->false_hits + r->doubles + (r->labels - r->hits);
+
+    return r->hits ? 2.0 * r->hits / (2.0 * r->hits + wrong) : 0.0;
+}
+
+static void build_grid(role_job_t *job)
+{
+    uint16_t period = job->base->role.sample_period_ms;
+    unsigned n = 0;
+
+    job->cand = calloc(N_GRID, sizeof(candidate_t));
+    if (!job->cand)
+    {
+        perror("calloc");
+        exit(1);
+    }
+
+    for (unsigned f = 0; f < N_FLOOR; f++)
+        for (unsigned m = 0; m < N_MULT; m++)
+            for (unsigned h = 0; h < N_HOLDOFF; h++)
+                for (unsigned s = 0; s < N_SLOPE; s++)
+                {
+                    candidate_t *c = &job->cand[n++];
+                    unsigned holdoff = (holdoff_ms[h] + period / 2) / period;
+
+                    c->role = job->base->role;
+                    c->floor_g = floor_g[f];
+                    c->slope_g = slope_g[s];
+                    c->role.det.trigger_floor = IMU_G_TO_RAW(floor_g[f]);
+                    c->role.det.noise_mult = noise_mult[m];
+                    c->role.det.holdoff = holdoff ? (holdoff > 255 ? 255 : holdoff) : 1;
+                    c->role.det.onset_slope = IMU_G_TO_RAW(slope_g[s]);
+                }
+    job->n_cand = n;
+}
+
+static void score(role_job_t *job, candidate_t *c)
+{
+    eval_result_t total;
+
+    eval_clear(&total);
+    for (int i = 0; i < job->n_traces; i++)
+    {
+        eval_result_t r;
+
+        eval_clear(&r);
+        if (eval_trace(&c->role, &job->traces[i], window_us, 0, &r) == 0)
+            eval_merge(&total, &r);
+    }
+
+    c->accuracy = accuracy(&total);
+    c->latency_ms = eval_latency_mean_ms(&total);
+    c->precision = eval_precision(&total);
+    c->recall = eval_recall(&total);
+    c->double_rate = eval_double_rate(&total);
+}
+
+static void *worker(void *arg)
+{
+    (void)arg;
+
+    for (;;)
+    {
+        role_job_t *job = NULL;
+        unsigned idx = 0;
+
+        pthread_mutex_lock(&lock);
+        for (int j = 0; j < n_jobs; j++)
+        {
+            if (jobs[j].next < jobs[j].n_cand)
+            {
+                job = &jobs[j];
+                idx = job->next++;
+                break;
+            }
+        }
+        pthread_mutex_unlock(&lock);
+
+        if (!job)
+            return NULL;
+        score(job, &job->cand[idx]);
+    }
+}
+
+static int by_latency(const void *a, const void *b)
+{
+    const candidate_t *x = a, *y = b;
+
+    if (x->latency_ms != y->latency_ms)
+        return x->latency_ms < y->latency_ms ? -1 : 1;
+    return x->accuracy > y->accuracy ? -1 : x->accuracy < y->accuracy;
+}
+
+/* Sort by latency; a candidate is on the front if it beats every faster one */
+static void pareto(role_job_t *job)
+{
+    double best_acc = -1.0, top = 0.0;
+
+    qsort(job->cand, job->n_cand, sizeof(candidate_t), by_latency);
+    for (unsigned i = 0; i < job->n_cand; i++)
+    {
+        candidate_t *c = &job->cand[i];
+
+        if (c->accuracy > best_acc)
+        {
+            c->pareto = 1;
+            best_acc = c->accuracy;
+        }
+    }
+    top = best_acc;
+
+    for (unsigned i = 0; i < job->n_cand; i++)
+    {
+        if (job->cand[i].pareto && job->cand[i].accuracy >= top - TUNE_ACCURACY_SLACK)
+        {
+            job->best = &job->cand[i];
+            break;
+        }
+    }
+}
+
+static void print_front(const role_job_t *job)
+{
+    printf("\n%s: %u candidates, %d traces\n", job->base->name, job->n_cand, job->n_traces);
+    printf("  %-5s %6s %5s %4s %6s  %8s %9s %6s %6s %6s\n",
+           "", "floor", "mult", "hold", "slope", "accuracy", "latency", "prec", "recall", "double");
+
+    for (unsigned i = 0; i < job->n_cand; i++)
+    {
+        const candidate_t *c = &job->cand[i];
+
+        if (!c->pareto)
+            continue;
+        printf("  %-5s %5.2fg %5u %4u %5.2fg  %8.3f %7.1fms %6.3f %6.3f %6.3f\n",
+               c == job->best ? "best" : "",
+               c->floor_g, c->role.det.noise_mult, c->role.det.holdoff, c->slope_g,
+               c->accuracy, c->latency_ms, c->precision, c->recall, c->double_rate);
+    }
+}
+
+static int write_header(const char *path, char **argv, int argc)
+{
+    FILE *f = fopen(path, "w");
+
+    if (!f)
+    {
+        perror(path);
+        return -1;
+    }
+
+    fprintf(f, "/* Generated by codes/Host/tune, do not edit. Build with -DROLES_TUNED.\n *\n *");
+    for (int i = 0; i < argc; i++)
+        fprintf(f, " %s", argv[i]);
+    fprintf(f, "\n */\n#ifndef ROLES_TUNED_H\n#define ROLES_TUNED_H\n");
+
+    for (int j = 0; j < n_jobs; j++)
+    {
+        const candidate_t *c = jobs[j].best;
+        const char *p = jobs[j].base->prefix;
+
+        if (!c)
+            continue;
+        fprintf(f, "\n/* %s: accuracy %.3f, mean latency %.1f ms over %d traces */\n",
+                jobs[j].base->name, c->accuracy, c->latency_ms, jobs[j].n_traces);
+        fprintf(f, "#define %s_TRIGGER_FLOOR IMU_G_TO_RAW(%.2ff)\n", p, c->floor_g);
+        fprintf(f, "#define %s_NOISE_MULT %u\n", p, c->role.det.noise_mult);
+        fprintf(f, "#define %s_HOLDOFF %u\n", p, c->role.det.holdoff);
+        fprintf(f, "#define %s_ONSET_SLOPE IMU_G_TO_RAW(%.2ff)\n", p, c->slope_g);
+    }
+
+    fprintf(f, "\n#endif /* ROLES_TUNED_H */\n");
+    fclose(f);
+    return 0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: tune [-j threads] [-w window_ms] [-o roles_tuned.h] "
+                    "-r role trace... [-r role trace...]\n");
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *out = "roles_tuned.h";
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    pthread_t *tid;
+    role_job_t *job = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            threads = atol(argv[++i]);
+        else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+            window_us = (uint32_t)(atof(argv[++i]) * 1000);
+        else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+            out = argv[++i];
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+        {
+            if (n_jobs == TUNE_MAX_ROLES)
+                usage();
+            job = &jobs[n_jobs++];
+            job->base = eval_find(argv[++i]);
+            if (!job->base)
+            {
+                fprintf(stderr, "unknown role %s\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (argv[i][0] == '-' || !job)
+            usage();
+        else
+        {
+            trace_t *t = realloc(job->traces, (job->n_traces + 1) * sizeof(trace_t));
+            if (!t)
+            {
+                perror("realloc");
+                return 1;
+            }
+            job->traces = t;
+            if (trace_load(argv[i], &job->traces[job->n_traces]) < 0)
+                return 1;
+            job->n_traces++;
+        }
+    }
+    if (n_jobs == 0)
+        usage();
+    if (threads < 1)
+        threads = 1;
+
+    for (int j = 0; j < n_jobs; j++)
+        build_grid(&jobs[j]);
+
+    fprintf(stderr, "tuning %d role(s), %u candidates each, %ld threads\n",
+            n_jobs, (unsigned)N_GRID, threads);
+
+    tid = calloc(threads, sizeof(pthread_t));
+    for (long i = 0; i < threads; i++)
+        pthread_create(&tid[i], NULL, worker, NULL);
+    for (long i = 0; i < threads; i++)
+        pthread_join(tid[i], NULL);
+    free(tid);
+
+    for (int j = 0; j < n_jobs; j++)
+    {
+        pareto(&jobs[j]);
+        print_front(&jobs[j]);
+    }
+
+    if (write_header(out, argv, argc) < 0)
+        return 1;
+    printf("\nwrote %s\n", out);
+    return 0;
+}
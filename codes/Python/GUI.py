@@ -7,6 +7,85 @@ import time
 import pygame
 import os
 
+SAMPLE_RATE = 44100         # the hub's frame clock
+JUDGE_WINDOW_MS = 150       # furthest a hit may be from its step, at most half a step
+
+# Hub pad numbers (pads[] in ESP32_audio_bt.ino)
+PAD_NUMBERS = {
+    'RH': 1, 'LH': 2, 'RF': 3,
+    'SNARE': 1, 'HIHAT': 2, 'KICK': 3, 'SKICK': 4, 'SSNARE': 5,
+    'HTOM': 6, 'FTOM': 7, 'CRASH': 8, 'RIDE': 9,
+}
+PAD_TOKENS = {1: 'RH', 2: 'LH', 3: 'RF'}
+
+
+class Score:
+    def __init__(self):
+        self.tempo = None       # None: an order-only sheet
+        self.beats = 4
+        self.grid = 1
+        self.count = 1
+        self.guide = False
+        self.notes = []         # (step, pad, token) for the player, in order
+        self.backing = []       # (step, pad)
+        self.length = 0         # steps
+
+
+def parse_score(text):
+    """
+    Parse a score (codes/HTML/sample_score.txt):
+
+      tempo 96          beats per minute; without it the sheet is matched
+                        in order only, as before
+      beats 4           beats per bar
+      grid 2            steps per beat, 2 for eighths
+      count 1           bars of count-in
+      guide on          the hub plays the player's notes quietly
+      play LH RH . RF   the player's part, one token per step
+      back hihat ...    a backing part the hub plays
+
+    A line without a keyword is a play line. Tokens are LH, RH, RF, a hub
+    pad name (snare, kick, ride, ...) or a pad number 1-9; '.' is a rest,
+    TOKEN:n holds for n steps and A+B strikes two pads on one step. Every
+    play and back line continues its part where the last one ended.
+    """
+    score = Score()
+    pos = {'play': 0, 'back': 0}
+
+    for line in text.splitlines():
+        words = line.split('#', 1)[0].split()
+        if not words:
+            continue
+        key = words[0].lower()
+        if key in ('tempo', 'beats', 'grid', 'count') and len(words) > 1:
+            setattr(score, key, int(words[1]))
+            continue
+        if key == 'guide' and len(words) > 1:
+            score.guide = words[1].lower() in ('on', '1', 'yes')
+            continue
+        part = 'play'
+        if key in ('play', 'back'):
+            part = key
+            words = words[1:]
+
+        for word in words:
+            token, _, hold = word.upper().partition(':')
+            steps = int(hold) if hold else 1
+            if token != '.':
+                for name in token.split('+'):
+                    pad = int(name) if name.isdigit() else PAD_NUMBERS.get(name)
+                    if not pad or not 1 <= pad <= 9:
+                        raise ValueError(f"Unknown token '{name}'")
+                    if part == 'play':
+                        score.notes.append((pos[part], pad, PAD_TOKENS.get(pad, name)))
+                    else:
+                        score.backing.append((pos[part], pad))
+            pos[part] += steps
+
+    score.notes.sort(key=lambda n: n[0])
+    score.length = max(pos.values())
+    return score
+
 
 class DrumKitApp:
     def __init__(self, root):
@@ -38,6 +117,10 @@ class DrumKitApp:
         self.correct = 0
         self.wrong = 0
         self.matching = False
+        self.score = None
+        self.expected = []          # per player note: hub frame it is due on, None until announced
+        self.step_offset = []       # per player note: ms early (-) or late (+)
+        self.now_frame = 0          # latest hub frame heard of
         self.read_thread = None
         self.running = False
         
@@ -241,7 +324,10 @@ class DrumKitApp:
                 font=('Poppins', 11, 'bold')).pack(pady=(12, 5))
         self.accuracy_label = tk.Label(acc_card, text="0%", fg='#FFD700', 
                                       bg='#1a2a3d', font=('Poppins', 32, 'bold'))
-        self.accuracy_label.pack(pady=(0, 12))
+        self.accuracy_label.pack(pady=(0, 4))
+        self.timing_label = tk.Label(acc_card, text="", fg='#8795a1',
+                                    bg='#1a2a3d', font=('Poppins', 10))
+        self.timing_label.pack(pady=(0, 12))
         
         live_feed_panel = tk.Frame(right, bg='#0f1a26', relief='raised', bd=1)
         live_feed_panel.pack(fill='both', expand=True, padx=15, pady=(0, 15))
@@ -306,9 +392,9 @@ class DrumKitApp:
         else:
             print(f"⚠️  No audio loaded for {drum_key}")
     
-    def add_to_live_feed(self, token, judgement):
+    def add_to_live_feed(self, token, judgement, detail=None):
         """Add hit to live feed display"""
-        timestamp = time.strftime("%H:%M:%S")
+        timestamp = detail or time.strftime("%H:%M:%S")
         self.hit_history.append((token, judgement, timestamp))
         
         if len(self.hit_history) > self.max_history:
@@ -364,7 +450,7 @@ class DrumKitApp:
             return
         
         try:
-            self.serial_port = serial.Serial(port, 9600, timeout=0.1)
+            self.serial_port = serial.Serial(port, 115200, timeout=0.1)
             self.connected = True
             self.connect_btn.config(state='disabled')
             self.disconnect_btn.config(state='normal')
@@ -398,7 +484,7 @@ class DrumKitApp:
                     line = self.serial_port.readline().decode('utf-8').strip()
                     if line:
                         print(f"📥 Received: '{line}'")
-                        self.root.after(0, self.on_hit_received, line)
+                        self.root.after(0, self.on_line_received, line)
             except Exception as e:
                 print(f"❌ Serial read error: {e}")
             time.sleep(0.01)
@@ -432,7 +518,125 @@ class DrumKitApp:
         }
         return mapping.get(drum_id, drum_id)
     
-    def animate_pad(self, token, judgement=None):
+    def send_line(self, line):
+        if self.serial_port and self.connected:
+            self.serial_port.write((line + '\n').encode())
+
+    def send_score(self):
+        """Load the score into the hub's sequencer and start it"""
+        score = self.score
+        self.send_line('Qc')
+        self.send_line(f'Qt{score.tempo} {score.grid} {score.length} {score.beats}')
+        self.send_line(f'Qg{1 if score.guide else 0}')
+        for step, pad, _ in score.notes:
+            self.send_line(f'Qn{step} {pad}')
+        for step, pad in score.backing:
+            self.send_line(f'Qb{step} {pad}')
+        self.send_line(f'Qp{score.count}')
+
+    def timed(self):
+        return self.score is not None and self.score.tempo is not None
+
+    def judge_window(self):
+        """Frames a hit may be off its step and still count"""
+        step = SAMPLE_RATE * 60 / (self.score.tempo * self.score.grid)
+        return min(step / 2, JUDGE_WINDOW_MS * SAMPLE_RATE / 1000)
+
+    def on_line_received(self, line):
+        """Dispatch a line from the hub"""
+        words = line.split()
+        if words[0] == 'STEP' and len(words) >= 4:
+            n = int(words[1])
+            if self.matching and n < len(self.expected):
+                self.expected[n] = int(words[3])
+            return
+        if words[0] == 'BEAT' and len(words) >= 5:
+            self.now_frame = max(self.now_frame, int(words[4]))
+            self.check_misses()
+            return
+        if line == 'SEQ end':
+            self.now_frame = float('inf')
+            self.check_misses()
+            self.finish_sheet()
+            return
+        if len(words) >= 2 and words[0].isdigit() and words[1].isdigit() and self.timed():
+            self.now_frame = max(self.now_frame, int(words[1]))
+            self.judge_hit(words[0], int(words[1]))
+            self.check_misses()
+            return
+        # the hub's status lines are not hits
+        if not self.map_token_to_id(words[0]):
+            return
+        if self.timed():
+            self.animate_pad(words[0], None)
+        else:
+            self.on_hit_received(words[0])
+
+    def judge_hit(self, raw_token, frame):
+        """Match a hit to the nearest open note of its pad, by hub frame"""
+        pad = int(raw_token)
+        if not self.matching:
+            self.animate_pad(raw_token, None)
+            return
+
+        window = self.judge_window()
+        best = None
+        for i, due in enumerate(self.expected):
+            if due is None or self.step_state[i] != 'pending':
+                continue
+            if self.score.notes[i][1] != pad or abs(frame - due) > window:
+                continue
+            if best is None or abs(frame - due) < abs(frame - self.expected[best]):
+                best = i
+
+        self.attempts += 1
+        if best is None:
+            self.wrong += 1
+            self.animate_pad(raw_token, 'wrong', 'extra')
+        else:
+            offset = round((frame - self.expected[best]) * 1000 / SAMPLE_RATE)
+            self.correct += 1
+            self.step_state[best] = 'correct'
+            self.step_offset[best] = offset
+            self.animate_pad(raw_token, 'correct', f'{offset:+d} ms')
+        self.advance_index()
+
+    def check_misses(self):
+        """Notes whose window has passed without a hit are wrong"""
+        if not self.matching:
+            return
+        window = self.judge_window()
+        missed = False
+        for i, due in enumerate(self.expected):
+            if due is not None and self.step_state[i] == 'pending' and due + window < self.now_frame:
+                self.step_state[i] = 'wrong'
+                self.attempts += 1
+                self.wrong += 1
+                missed = True
+        if missed:
+            self.advance_index()
+
+    def advance_index(self):
+        self.index = next((i for i, st in enumerate(self.step_state) if st == 'pending'), len(self.sheet))
+        self.render_sheet()
+        self.update_progress()
+
+    def finish_sheet(self):
+        self.matching = False
+        self.start_btn.config(text="▶ Start", bg='#26A69A')
+        self.render_sheet()
+        accuracy = round((self.correct / self.attempts) * 100) if self.attempts > 0 else 0
+        print(f"\n🎯 SHEET COMPLETE! Accuracy: {accuracy}%  {self.timing_text()}\n")
+
+    def timing_text(self):
+        offsets = [o for o in self.step_offset if o is not None]
+        if not offsets:
+            return ""
+        mean = sum(offsets) / len(offsets)
+        spread = (sum((o - mean) ** 2 for o in offsets) / len(offsets)) ** 0.5
+        return f"Timing {mean:+.0f} ms ± {spread:.0f} ms"
+
+    def animate_pad(self, token, judgement=None, detail=None):
         drum_id = self.map_token_to_id(token)
         if not drum_id or drum_id not in self.drums:
             print(f"⚠️  Unknown token: '{token}'")
@@ -441,7 +645,7 @@ class DrumKitApp:
         self.play_sound(drum_id)
         
         display_token = self.get_display_token(drum_id)
-        self.add_to_live_feed(display_token, judgement if judgement else 'neutral')
+        self.add_to_live_feed(display_token, judgement if judgement else 'neutral', detail)
         
         drum = self.drums[drum_id]
         
@@ -506,6 +710,22 @@ class DrumKitApp:
             messagebox.showwarning("Warning", "Please load a sheet first")
             return
         
+        if self.timed():
+            if not self.connected:
+                messagebox.showwarning("Warning", "Connect to the hub to play a timed score")
+                return
+            if self.matching:
+                self.send_line('Qs')
+                self.finish_sheet()
+                return
+            self.reset_sheet()
+            self.matching = True
+            self.send_score()
+            self.start_btn.config(text="■ Stop", bg='#FF9500')
+            print(f"\n▶️  SCORE STARTED - {self.score.tempo} bpm, {len(self.sheet)} notes\n")
+            self.render_sheet()
+            return
+
         self.matching = not self.matching
         
         if self.matching:
@@ -524,6 +744,11 @@ class DrumKitApp:
         self.correct = 0
         self.wrong = 0
         self.step_state = ['pending'] * len(self.sheet)
+        self.expected = [None] * len(self.sheet)
+        self.step_offset = [None] * len(self.sheet)
+        self.now_frame = 0
+        if self.timed() and self.connected:
+            self.send_line('Qs')
         self.start_btn.config(text="▶ Start", bg='#26A69A')
         self.render_sheet()
         self.update_progress()
@@ -546,9 +771,15 @@ class DrumKitApp:
             self.load_sheet_from_text(content)
     
     def load_sheet_from_text(self, text):
-        tokens = text.strip().upper().split()
-        self.sheet = [self.normalize_token(t) for t in tokens if t]
+        try:
+            self.score = parse_score(text)
+        except ValueError as e:
+            messagebox.showerror("Score Error", str(e))
+            return
+        self.sheet = [token for _, _, token in self.score.notes]
         self.step_state = ['pending'] * len(self.sheet)
+        self.expected = [None] * len(self.sheet)
+        self.step_offset = [None] * len(self.sheet)
         self.index = 0
         self.attempts = 0
         self.correct = 0
@@ -557,17 +788,8 @@ class DrumKitApp:
         self.start_btn.config(text="▶ Start", bg='#26A69A')
         self.render_sheet()
         self.update_progress()
-        print(f"\n📋 Loaded sheet ({len(self.sheet)} steps): {' '.join(self.sheet)}\n")
-    
-    def normalize_token(self, token):
-        mapped = self.map_token_to_id(token)
-        if mapped == 'L_HAND':
-            return 'LH'
-        elif mapped == 'R_HAND':
-            return 'RH'
-        elif mapped == 'R_FOOT':
-            return 'RF'
-        return token
+        timing = f", {self.score.tempo} bpm" if self.timed() else ""
+        print(f"\n📋 Loaded sheet ({len(self.sheet)} steps{timing}): {' '.join(self.sheet)}\n")
     
     def render_sheet(self):
         """Render sheet with clear visual progress tracking"""
@@ -604,7 +826,10 @@ class DrumKitApp:
             step_frame = tk.Frame(self.sheet_display, bg=border_color, padx=1, pady=1)
             step_frame.pack(side='left', padx=3, pady=3)
             
-            step = tk.Label(step_frame, text=token, bg=bg_color, fg=fg_color,
+            text = token
+            if self.step_offset[i] is not None:
+                text += f"\n{self.step_offset[i]:+d}"
+            step = tk.Label(step_frame, text=text, bg=bg_color, fg=fg_color,
                           font=('Poppins', 14, 'bold'), padx=12, pady=8, relief='flat')
             step.pack()
     
@@ -632,6 +857,7 @@ class DrumKitApp:
                 self.accuracy_label.config(fg='#FF6B6B')  # Red
         else:
             self.accuracy_label.config(text="0%", fg='#8795a1')
+        self.timing_label.config(text=self.timing_text())
 
 
 if __name__ == "__main__":
@@ -0,0 +1,258 @@
+"""
+Build the hub's drum samples from a kit of WAV files.
+
+Every sample is converted to the hub's engine format (16-bit PCM at
+--rate), then:
+
+  1. resampled with a windowed-sinc filter if its rate differs;
+  2. trimmed so its onset lands on frame 0. The onset is the first frame
+     whose level reaches --threshold-db relative to the sample's peak,
+     moved back to the zero crossing before it (at most --backoff-ms) so the
+     cut does not click. Leading silence and a slow pre-attack before the
+     hub starts the voice are pure latency;
+  3. gain-staged: normalised to --peak-db, or --gain-db added instead;
+  4. down-mixed to mono with --mono (the hub plays mono and stereo).
+
+The result is written as either
+
+  --header WavData.h   one `unsigned const char name[]` array per sample
+                       holding a canonical 44-byte WAV, which is what
+                       playSound() in ESP32_audio_bt.ino reads, or
+  --bank bank.bin      a sample bank for the "samples" flash partition
+                       (BANK_HEADER_T, BANK_ENTRY_T in ESP32_audio_bt.ino),
+                       flashed with
+                       esptool.py write_flash 0x210000 bank.bin
+
+Usage: python sample_bank.py snare.wav kick.wav hihat=Hihat.wav --header WavData.h
+
+A sample is named after its file (lower case, without extension) unless
+given as name=path; the hub maps bank entries to pads by that name.
+Standard library only.
+"""
+
+import argparse
+import math
+import os
+import struct
+import sys
+import wave
+
+ENGINE_RATE = 44100
+BANK_MAGIC = b'DRMB'
+BANK_VERSION = 1
+BANK_NAME_LEN = 16
+BANK_ENTRY = struct.Struct('<%dsIIIHH' % BANK_NAME_LEN)
+BANK_HEADER = struct.Struct('<4sHH')
+SINC_TAPS = 32              # per side, at the lower of the two rates
+
+
+class Sample:
+    def __init__(self, name, path, rate, channels):
+        self.name = name
+        self.path = path
+        self.rate = rate
+        self.channels = channels
+        self.frames = []        # list of per-channel lists, floats in -1..1
+        self.trimmed_ms = 0.0
+        self.gain_db = 0.0
+        self.clipped = 0
+
+
+def read_wav(name, path):
+    with wave.open(path, 'rb') as w:
+        width = w.getsampwidth()
+        channels = w.getnchannels()
+        rate = w.getframerate()
+        raw = w.readframes(w.getnframes())
+
+    s = Sample(name, path, rate, channels)
+    if width == 1:
+        values = [(b - 128) / 128.0 for b in raw]
+    elif width == 2:
+        values = [v / 32768.0 for v in struct.unpack('<%dh' % (len(raw) // 2), raw)]
+    elif width == 3:
+        values = []
+        for i in range(0, len(raw), 3):
+            v = raw[i] | (raw[i + 1] << 8) | (raw[i + 2] << 16)
+            values.append((v - (1 << 24) if v & 0x800000 else v) / 8388608.0)
+    else:
+        raise ValueError('%s: %d-byte samples are not supported' % (path, width))
+
+    s.frames = [values[c::channels] for c in range(channels)]
+    return s
+
+
+def resample(chan, src_rate, dst_rate):
+    """Windowed-sinc (Hann) resampling, cut off at the lower Nyquist."""
+    if src_rate == dst_rate:
+        return list(chan)
+
+    ratio = dst_rate / float(src_rate)
+    cutoff = min(1.0, ratio)                # of the source Nyquist
+    half = int(math.ceil(SINC_TAPS / cutoff))
+    n_out = int(len(chan) * ratio)
+    out = []
+
+    for j in range(n_out):
+        t = j / ratio
+        centre = int(math.floor(t))
+        acc = 0.0
+        for k in range(centre - half + 1, centre + half + 1):
+            if k < 0 or k >= len(chan):
+                continue
+            x = t - k
+            window = 0.5 + 0.5 * math.cos(math.pi * x / half)
+            arg = math.pi * x * cutoff
+            sinc = cutoff if arg == 0 else cutoff * math.sin(arg) / arg
+            acc += chan[k] * sinc * window
+        out.append(acc)
+    return out
+
+
+def peak(frames):
+    return max((abs(v) for chan in frames for v in chan), default=0.0)
+
+
+def find_onset(frames, rate, threshold_db, backoff_ms):
+    """First frame reaching the threshold, backed off to a zero crossing."""
+    top = peak(frames)
+    if top == 0:
+        return 0
+
+    level = top * 10 ** (threshold_db / 20.0)
+    n = len(frames[0])
+    onset = next((i for i in range(n) if any(abs(chan[i]) >= level for chan in frames)), 0)
+
+    # back to where the (first channel's) signal last changed sign
+    chan = frames[0]
+    limit = max(0, onset - int(backoff_ms * rate / 1000.0))
+    i = onset
+    while i > limit and (chan[i - 1] >= 0) == (chan[onset] >= 0):
+        i -= 1
+    return i
+
+
+def process(s, args):
+    s.frames = [resample(chan, s.rate, args.rate) for chan in s.frames]
+    s.rate = args.rate
+
+    onset = find_onset(s.frames, s.rate, args.threshold_db, args.backoff_ms)
+    s.frames = [chan[onset:] for chan in s.frames]
+    s.trimmed_ms = onset * 1000.0 / s.rate
+
+    if args.mono and s.channels > 1:
+        s.frames = [[sum(f) / s.channels for f in zip(*s.frames)]]
+        s.channels = 1
+
+    top = peak(s.frames)
+    if args.gain_db is not None:
+        s.gain_db = args.gain_db
+    elif top > 0:
+        s.gain_db = args.peak_db - 20 * math.log10(top)
+    gain = 10 ** (s.gain_db / 20.0)
+    s.frames = [[v * gain for v in chan] for chan in s.frames]
+
+
+def pcm16(s):
+    """Interleaved little-endian 16-bit PCM."""
+    values = []
+    for frame in zip(*s.frames):
+        for v in frame:
+            q = int(round(v * 32767))
+            if q > 32767 or q < -32768:
+                s.clipped += 1
+                q = max(-32768, min(32767, q))
+            values.append(q)
+    return struct.pack('<%dh' % len(values), *values)
+
+
+def wav_bytes(s, pcm):
+    block = 2 * s.channels
+    return (b'RIFF' + struct.pack('<I', 36 + len(pcm)) + b'WAVE' +
+            b'fmt ' + struct.pack('<IHHIIHH', 16, 1, s.channels, s.rate, s.rate * block, block, 16) +
+            b'data' + struct.pack('<I', len(pcm)) + pcm)
+
+
+def write_header(path, samples):
+    with open(path, 'w') as out:
+        out.write('// Generated by codes/Python/sample_bank.py, do not edit\n')
+        for s in samples:
+            data = wav_bytes(s, pcm16(s))
+            out.write('unsigned const char %s[%d] = {\n' % (s.name, len(data)))
+            for i in range(0, len(data), 12):
+                out.write('\t' + ', '.join('0x%02X' % b for b in data[i:i + 12]) + ',\n')
+            out.write('};\n')
+
+
+def write_bank(path, samples):
+    table_end = BANK_HEADER.size + BANK_ENTRY.size * len(samples)
+    image = bytearray(table_end)
+    entries = []
+
+    for s in samples:
+        pcm = pcm16(s)
+        image += b'\0' * (-len(image) % 4)
+        entries.append(BANK_ENTRY.pack(s.name.encode(), len(image), len(pcm), s.rate, s.channels, 0))
+        image += pcm
+
+    image[:table_end] = BANK_HEADER.pack(BANK_MAGIC, BANK_VERSION, len(samples)) + b''.join(entries)
+    with open(path, 'wb') as out:
+        out.write(image)
+    return len(image)
+
+
+def parse_input(arg):
+    if '=' in arg:
+        name, path = arg.split('=', 1)
+    else:
+        path = arg
+        name = os.path.splitext(os.path.basename(arg))[0]
+    name = name.lower()
+    if not name.isidentifier() or len(name) >= BANK_NAME_LEN:
+        raise SystemExit('%s: not a usable sample name, use name=path' % name)
+    return name, path
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Build the hub drum samples from WAV files.')
+    parser.add_argument('inputs', nargs='+', help='WAV files, or name=path')
+    out = parser.add_mutually_exclusive_group(required=True)
+    out.add_argument('--header', help='write a C header of WAV arrays')
+    out.add_argument('--bank', help='write a flash sample bank image')
+    parser.add_argument('--rate', type=int, default=ENGINE_RATE, help='engine sample rate')
+    parser.add_argument('--threshold-db', type=float, default=-30.0,
+                        help='onset level relative to the peak')
+    parser.add_argument('--backoff-ms', type=float, default=1.0,
+                        help='how far back from the onset to look for a zero crossing')
+    parser.add_argument('--peak-db', type=float, default=-1.0, help='normalise peaks to this dBFS')
+    parser.add_argument('--gain-db', type=float, help='fixed gain instead of normalising')
+    parser.add_argument('--mono', action='store_true', help='down-mix to mono')
+    args = parser.parse_args()
+
+    samples = []
+    for arg in args.inputs:
+        name, path = parse_input(arg)
+        s = read_wav(name, path)
+        process(s, args)
+        samples.append(s)
+
+    if args.header:
+        write_header(args.header, samples)
+        target = args.header
+    else:
+        size = write_bank(args.bank, samples)
+        target = '%s (%d bytes)' % (args.bank, size)
+
+    # trimmed: latency the sample no longer adds before its onset
+    print('%-10s %8s %3s %8s %8s %s' % ('sample', 'trimmed', 'ch', 'length', 'gain', 'source'))
+    for s in samples:
+        n = len(s.frames[0])
+        print('%-10s %6.1fms %3d %6.0fms %+6.1fdB %s%s'
+              % (s.name, s.trimmed_ms, s.channels, n * 1000.0 / s.rate, s.gain_db, s.path,
+                 '  (%d clipped)' % s.clipped if s.clipped else ''))
+    print('-> %s' % target)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,158 @@
+"""
+Record raw IMU traces from a node, together with the hits the hub played.
+
+The hub forwards trace frames (codes/ATmega/trace.h) from the nodes to USB
+unchanged and prints "1", "2" or "3" on its own line for every hit it
+triggers. This tool starts tracing on the nodes, reads that mixed stream and
+writes a text trace file until Ctrl+C, then stops tracing.
+
+Usage: python trace_capture.py /dev/ttyUSB0 snare_run1.trace [--baud 115200]
+
+Trace file format, one record per line, '#' lines are comments:
+
+    # drum trace v1
+    # acc_lsb_per_g 4096
+    # gyro_mdps_per_lsb 70
+    # odr_hz 208
+    s <seq> <t_us> <ax> <ay> <az> <gx> <gy> <gz>
+    h <t_us> <pad>
+
+  s  one sensor sample. seq counts sensor samples from the start of the
+     capture (gaps are samples the node dropped or decimated). t_us is node
+     time in microseconds from the first frame. Axes are raw counts.
+  h  a hit played by the hub. The hub adds no timestamp, so t_us is the node
+     time of the last sample received before the hit line; pad is 1 snare,
+     2 hi-hat, 3 kick.
+
+Not written by this tool, but read by codes/Host/replay:
+
+    l <t_us> [pad]
+
+  l  a labelled strike onset, added by hand or by a labelling step. The
+     replay scores detections against these.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+import serial
+
+TRACE_SYNC = 0xE3
+TRACE_FRAME_LEN = 18
+TRACE_CMD_START = b'T'
+TRACE_CMD_STOP = b't'
+
+ACC_LSB_PER_G = 4096
+GYRO_MDPS_PER_LSB = 70
+ODR_HZ = 208
+
+HIT_TOKENS = (b'1', b'2', b'3')
+
+
+class TraceDecoder:
+    """Split the hub's USB stream into trace frames and text lines."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.seq = None         # unwrapped sample count
+        self.last_seq8 = 0
+        self.t_ms = None        # unwrapped node milliseconds
+        self.last_ms16 = 0
+        self.t0_us = None
+        self.last_t_us = 0
+        self.bad_frames = 0
+
+    def feed(self, data):
+        """Yield ('s', fields) for samples and ('h', pad) for hits."""
+        self.buf.extend(data)
+        line = bytearray()
+
+        while self.buf:
+            b = self.buf[0]
+            if b == TRACE_SYNC:
+                if len(self.buf) < TRACE_FRAME_LEN:
+                    break
+                frame = bytes(self.buf[:TRACE_FRAME_LEN])
+                if sum(frame[1:-1]) & 0xFF == frame[-1]:
+                    del self.buf[:TRACE_FRAME_LEN]
+                    yield 's', self._sample(frame)
+                    continue
+                self.bad_frames += 1
+            elif b == ord('\n'):
+                token = bytes(line).strip()
+                line.clear()
+                if token in HIT_TOKENS:
+                    yield 'h', int(token)
+            else:
+                line.append(b)
+            del self.buf[0]
+
+        # keep a partial text line for the next read
+        self.buf[0:0] = line
+
+    def _sample(self, frame):
+        seq8, ms16, sub = struct.unpack_from('<BHB', frame, 1)
+        axes = struct.unpack_from('<6h', frame, 5)
+
+        if self.seq is None:
+            self.seq = 0
+            self.t_ms = 0
+        else:
+            self.seq += (seq8 - self.last_seq8) & 0xFF
+            self.t_ms += (ms16 - self.last_ms16) & 0xFFFF
+        self.last_seq8 = seq8
+        self.last_ms16 = ms16
+
+        t_us = self.t_ms * 1000 + sub * 4
+        if self.t0_us is None:
+            self.t0_us = t_us
+        self.last_t_us = t_us - self.t0_us
+        return (self.seq, self.last_t_us) + axes
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Capture node IMU traces through the hub.')
+    parser.add_argument('port', help='hub USB serial port, e.g. /dev/ttyUSB0')
+    parser.add_argument('output', help='trace file to write')
+    parser.add_argument('--baud', type=int, default=115200)
+    args = parser.parse_args()
+
+    port = serial.Serial(args.port, args.baud, timeout=0.1)
+    decoder = TraceDecoder()
+    samples = hits = 0
+
+    with open(args.output, 'w') as out:
+        out.write('# drum trace v1\n')
+        out.write('# acc_lsb_per_g %d\n' % ACC_LSB_PER_G)
+        out.write('# gyro_mdps_per_lsb %d\n' % GYRO_MDPS_PER_LSB)
+        out.write('# odr_hz %d\n' % ODR_HZ)
+        out.write('# captured %s from %s\n' % (time.strftime('%Y-%m-%d %H:%M:%S'), args.port))
+
+        port.reset_input_buffer()
+        port.write(TRACE_CMD_START)
+        print('Tracing, Ctrl+C to stop')
+
+        try:
+            while True:
+                for kind, value in decoder.feed(port.read(512)):
+                    if kind == 's':
+                        out.write('s %d %d %d %d %d %d %d %d\n' % value)
+                        samples += 1
+                    else:
+                        out.write('h %d %d\n' % (decoder.last_t_us, value))
+                        hits += 1
+        except KeyboardInterrupt:
+            pass
+        finally:
+            port.write(TRACE_CMD_STOP)
+            port.close()
+
+    print('%d samples, %d hits, %d bad frames -> %s'
+          % (samples, hits, decoder.bad_frames, args.output))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())